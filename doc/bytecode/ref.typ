@@ -1,6 +1,6 @@
 #import "@preview/meander:0.2.4"
 
-#let revision-no = 6
+#let revision-no = 7
 
 #set page(columns: 4, margin: 0.5cm, flipped: true)
 #set columns(gutter: 5pt)
@@ -308,7 +308,24 @@
   ([`CALL Barray `$n$], [`74 [`$n$`: i32]`], [
     Calls the built-in function `.array`.
     The function creates an array composed of the $n$ operands and returns it.
-  ], $n$, 1)
+  ], $n$, 1),
+
+  (`CALL Lreadall`, `75`, [
+    Calls the built-in function `readAll` (a Friar extension).
+    The function reads the rest of the program input as whitespace-separated integers and returns them as an array.
+    If the input contains anything else, raises an error.
+  ], 0, 1),
+
+  (`CALL Lreadline`, `76`, [
+    Calls the built-in function `readLine` (a Friar extension).
+    The function returns the next line of the program input as a string, without the line terminator.
+    If the program input is exhausted, returns 0.
+  ], 0, 1),
+
+  (`CALL Lreadfile`, `77`, [
+    Calls the built-in function `readFile` (a Friar extension).
+    The function returns the rest of the program input as a string.
+  ], 0, 1)
 )
 
 #[
@@ -0,0 +1,51 @@
+#!/usr/bin/env bash
+
+# Measures the end-to-end time of running a trivial program, which is dominated by startup:
+# process creation, module loading and verification, and runtime initialization.
+#
+# Prints the mean time per run. If MAX_US is set, fails when the mean exceeds it, so the script can
+# guard against startup regressions.
+
+set -eo pipefail
+
+LAMAC="${LAMAC:-lamac}"
+FRIAR="${FRIAR:-build/friar}"
+BUILD_DIR="${BUILD_DIR:-build/bench-startup}"
+RUNS="${RUNS:-200}"
+MAX_US="${MAX_US:-}"
+
+FRIAR="$(realpath "$FRIAR")"
+mkdir -p "$BUILD_DIR"
+
+cat >"$BUILD_DIR/Trivial.lama" <<'EOF'
+write (42)
+EOF
+
+(cd "$BUILD_DIR" && "$LAMAC" -b Trivial.lama)
+BC_FILE="$BUILD_DIR/Trivial.bc"
+
+if [ "$("$FRIAR" "$BC_FILE" </dev/null)" != "42" ]; then
+	echo -e "\033[91mthe trivial program produced unexpected output\033[m" >&2
+	exit 1
+fi
+
+# warm up the page cache.
+for _ in $(seq 10); do
+	"$FRIAR" "$BC_FILE" </dev/null >/dev/null
+done
+
+START=$(date +%s%N)
+
+for _ in $(seq "$RUNS"); do
+	"$FRIAR" "$BC_FILE" </dev/null >/dev/null
+done
+
+END=$(date +%s%N)
+MEAN_US=$(((END - START) / RUNS / 1000))
+
+echo "mean time per run: $MEAN_US μs ($RUNS runs)"
+
+if [ -n "$MAX_US" ] && [ "$MEAN_US" -gt "$MAX_US" ]; then
+	echo -e "\033[91mstartup regression: $MEAN_US μs exceeds the limit of $MAX_US μs\033[m" >&2
+	exit 1
+fi
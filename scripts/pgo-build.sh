@@ -0,0 +1,72 @@
+#!/usr/bin/env bash
+
+# Builds Friar with link-time and profile-guided optimizations, including the Lama runtime.
+#
+# The instrumented build is trained by running every bytecode file in the corpus directory
+# (with `<name>.input` as its input, if present); the optimized build then uses the profile.
+
+set -eo pipefail
+
+BUILD_DIR="${BUILD_DIR:-build-pgo}"
+CORPUS_DIR="${CORPUS_DIR:-${1:-}}"
+LLVM_PROFDATA="${LLVM_PROFDATA:-llvm-profdata}"
+
+if [ -z "$CORPUS_DIR" ]; then
+	echo "usage: $0 <corpus-dir>" >&2
+	echo "  <corpus-dir> is a directory of Lama bytecode files (*.bc) to train on." >&2
+	exit 2
+fi
+
+shopt -s nullglob
+CORPUS=("$CORPUS_DIR"/*.bc)
+
+if [[ ${#CORPUS[@]} -eq 0 ]]; then
+	echo "no bytecode files found in $CORPUS_DIR" >&2
+	exit 1
+fi
+
+CORPUS_DIR="$(realpath "$CORPUS_DIR")"
+CORPUS=("$CORPUS_DIR"/*.bc)
+
+echo -e "\033[1mBuilding the instrumented executable...\033[m" >&2
+
+if [ -d "$BUILD_DIR" ]; then
+	meson configure "$BUILD_DIR" -Db_pgo=generate
+else
+	meson setup "$BUILD_DIR" \
+		-Doptimization=3 \
+		-Db_lto=true \
+		-Db_pgo=generate \
+		-Druntime_from_source=true
+fi
+
+rm -f "$BUILD_DIR"/*.profraw "$BUILD_DIR"/default.profdata
+find "$BUILD_DIR" -name '*.gcda' -delete
+meson compile -C "$BUILD_DIR"
+
+for BC_FILE in "${CORPUS[@]}"; do
+	INPUT_FILE="${BC_FILE%.*}.input"
+
+	if ! [ -f "$INPUT_FILE" ]; then
+		INPUT_FILE=/dev/null
+	fi
+
+	echo -e "\033[1mTraining on $BC_FILE...\033[m" >&2
+
+	# run from the build directory: Clang writes its raw profiles to the working directory.
+	(cd "$BUILD_DIR" && ./friar "$BC_FILE" <"$INPUT_FILE" >/dev/null) ||
+		echo -e "\033[91m$BC_FILE exited with an error\033[m" >&2
+done
+
+PROFRAW=("$BUILD_DIR"/*.profraw)
+
+if [[ ${#PROFRAW[@]} -ne 0 ]]; then
+	"$LLVM_PROFDATA" merge -output="$BUILD_DIR/default.profdata" "${PROFRAW[@]}"
+fi
+
+echo -e "\033[1mBuilding the optimized executable...\033[m" >&2
+
+meson configure "$BUILD_DIR" -Db_pgo=use
+meson compile -C "$BUILD_DIR"
+
+echo -e "\033[1mDone: $BUILD_DIR/friar\033[m" >&2
@@ -1,6 +1,8 @@
 #include "args.hpp"
 
+#include <charconv>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
 #include <optional>
@@ -14,18 +16,136 @@ namespace {
 std::string_view usage =
     "Usage: friar [-h] [--mode=MODE] [--] <input>\n"
     "\n"
-    "  <input>       A path to the Lama bytecode file to interpret.\n"
+    "  <input>       A path to the Lama bytecode file to interpret\n"
+    "                (or to the trace file in the decode-trace mode).\n"
     "\n"
     "Options:\n"
     "  -h, --help    Print this help message.\n"
     "\n"
     "  -t, --time    Measure the execution time.\n"
     "\n"
+    "  --gc-stats    Print heap allocation and garbage collection statistics.\n"
+    "\n"
+    "  --mem         Report the memory usage: the peak RSS growth of each stage\n"
+    "                and the high-water marks of the interpreter's stacks and heap.\n"
+    "\n"
     "  --mode=MODE   Select the execution mode. Available choices:\n"
     "                - disas: disassemble the bytecode and exit.\n"
     "                - verify: only perform bytecode verification.\n"
     "                - idiom: search for bytecode idioms.\n"
-    "                - run: execute the bytecode (default).";
+    "                - run: execute the bytecode (default).\n"
+    "                - decode-trace: print an execution trace recorded\n"
+    "                  with --trace-file in a textual form.\n"
+    "                - relayout: order the procedures by hotness according to\n"
+    "                  --profile, move blocks ending in FAIL out of the\n"
+    "                  hot path, and write the result to --output.\n"
+    "                - strip: remove the procedures unreachable from main\n"
+    "                  and write the result to --output.\n"
+    "                - stats: print static statistics of the procedures.\n"
+    "\n"
+    "  --trace-events=FILE\n"
+    "                Write a timeline of the run to FILE in the Chrome Trace Event\n"
+    "                format: execution stages, garbage collections, and blocking I/O.\n"
+    "\n"
+    "  --trace-calls=USEC\n"
+    "                Also add procedure calls that take at least USEC microseconds\n"
+    "                to the timeline.\n"
+    "\n"
+    "  --alloc-profile=FILE\n"
+    "                Write the number and size of objects allocated by each\n"
+    "                bytecode instruction to FILE.\n"
+    "\n"
+    "  --heap-dump=FILE\n"
+    "                Write a census of the reachable heap objects to FILE at exit\n"
+    "                and whenever the process receives SIGUSR1.\n"
+    "\n"
+    "  --heap-dump-at=N\n"
+    "                Also write a heap dump after N objects have been allocated.\n"
+    "\n"
+    "  --heap-dump-graph\n"
+    "                Include every reachable object in heap dumps, along with\n"
+    "                the object or root it is retained by.\n"
+    "\n"
+    "  --async-output\n"
+    "                Write the program output from a background thread, so that\n"
+    "                the interpreter does not wait for slow pipes or disks.\n"
+    "\n"
+    "  --bulk-input  Replace the public procedures readAll, readLine, and readFile\n"
+    "                with the bulk input instructions.\n"
+    "\n"
+    "  --max-stack=N Limit the value stack to N values, including the globals.\n"
+    "\n"
+    "  --max-call-depth=N\n"
+    "                Limit the number of nested procedure calls to N.\n"
+    "\n"
+    "  --stack-prealloc=N\n"
+    "                Commit memory to N value stack slots before the run starts.\n"
+    "\n"
+    "  --profile=FILE\n"
+    "                Read the call-graph profile (written by --callgrind-out) that\n"
+    "                guides the relayout mode from FILE.\n"
+    "\n"
+    "  -o FILE, --output=FILE\n"
+    "                Write the bytecode produced by the relayout or strip mode\n"
+    "                to FILE.\n"
+    "\n"
+    "  --strip-lines Also remove line number information in the strip mode.\n"
+    "\n"
+    "  --json        Print the statistics in the stats mode as JSON."
+#ifndef DYNAMIC_VERIFICATION
+    "\n"
+    "\n"
+    "  --scalar-replace\n"
+    "                Pass the tuples returned by the procedures that the stats mode\n"
+    "                marks replaceable as separate values instead of allocating them."
+#endif
+#ifdef CALL_GRAPH_PROFILER
+    "\n"
+    "\n"
+    "  --callgrind-out=FILE\n"
+    "                Write the call-graph profile of the run to FILE in the\n"
+    "                Callgrind format."
+#endif
+#ifdef COVERAGE
+    "\n"
+    "\n"
+    "  --coverage-out=FILE\n"
+    "                Write the source line coverage of the run to FILE in the\n"
+    "                lcov tracefile format."
+#endif
+#ifdef RUNTIME_METRICS
+    "\n"
+    "\n"
+    "  --metrics=FILE\n"
+    "                Periodically write runtime metrics to FILE in the Prometheus\n"
+    "                text format.\n"
+    "\n"
+    "  --metrics-interval=MS\n"
+    "                Refresh the metrics file every MS milliseconds (1000 by default)."
+#endif
+#if INTERPRETER_TRACE
+    "\n"
+    "\n"
+    "  --trace-file=FILE\n"
+    "                Record the execution trace to FILE (friar.trace by default).\n"
+    "\n"
+    "  --trace-capacity=N\n"
+    "                Keep only the last N executed instructions in the trace\n"
+    "                (rounded up to a power of two; 1048576 by default,\n"
+    "                at most 4294967296)."
+#endif
+    ;
+
+std::optional<uint64_t> parse_uint(std::string_view s) {
+    uint64_t result = 0;
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), result);
+
+    if (ec != std::errc() || ptr != s.data() + s.size()) {
+        return std::nullopt;
+    }
+
+    return result;
+}
 
 } // namespace
 
@@ -48,6 +168,16 @@ Args Args::parse_or_exit(int argc, char **argv) {
                 exit(0);
             } else if (arg == "-t" || arg == "--time") {
                 result.time = true;
+            } else if (arg == "-o") {
+                if (++idx == argc) {
+                    std::println(std::cerr, "-o requires a value");
+                    std::println(std::cerr, "{}", usage);
+
+                    // NOLINTNEXTLINE(concurrency-mt-unsafe)
+                    exit(2);
+                }
+
+                result.output_file = argv[idx];
             } else if (arg.starts_with("--")) {
                 arg.remove_prefix(2);
                 auto name = arg;
@@ -58,15 +188,41 @@ Args Args::parse_or_exit(int argc, char **argv) {
                     value = arg.substr(pos + 1);
                 }
 
-                if (name == "mode") {
+                auto require_value = [&] {
                     if (!value) {
-                        std::println(std::cerr, "--mode requires a value");
+                        std::println(std::cerr, "--{} requires a value", name);
                         std::println(std::cerr, "{}", usage);
 
                         // NOLINTNEXTLINE(concurrency-mt-unsafe)
                         exit(2);
                     }
 
+                    return *value;
+                };
+
+                auto require_uint = [&] {
+                    auto r = parse_uint(require_value());
+
+                    if (!r) {
+                        std::println(
+                            std::cerr, "--{} requires a non-negative integer, got {}", name, *value
+                        );
+                        std::println(std::cerr, "{}", usage);
+
+                        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+                        exit(2);
+                    }
+
+                    return *r;
+                };
+
+                if (name == "gc-stats") {
+                    result.gc_stats = true;
+                } else if (name == "mem") {
+                    result.mem = true;
+                } else if (name == "mode") {
+                    require_value();
+
                     if (value == "disas") {
                         result.mode = Mode::Disas;
                     } else if (value == "verify") {
@@ -75,6 +231,14 @@ Args Args::parse_or_exit(int argc, char **argv) {
                         result.mode = Mode::Idiom;
                     } else if (value == "run") {
                         result.mode = Mode::Run;
+                    } else if (value == "decode-trace") {
+                        result.mode = Mode::DecodeTrace;
+                    } else if (value == "relayout") {
+                        result.mode = Mode::Relayout;
+                    } else if (value == "strip") {
+                        result.mode = Mode::Strip;
+                    } else if (value == "stats") {
+                        result.mode = Mode::Stats;
                     } else {
                         std::println(std::cerr, "Unrecognized mode: {}", *value);
                         std::println(std::cerr, "{}", usage);
@@ -82,6 +246,60 @@ Args Args::parse_or_exit(int argc, char **argv) {
                         // NOLINTNEXTLINE(concurrency-mt-unsafe)
                         exit(2);
                     }
+                } else if (name == "trace-events") {
+                    result.trace_events_file = require_value();
+                } else if (name == "trace-calls") {
+                    result.trace_call_threshold = std::chrono::microseconds(require_uint());
+                } else if (name == "alloc-profile") {
+                    result.alloc_profile_file = require_value();
+                } else if (name == "heap-dump") {
+                    result.heap_dump_file = require_value();
+                } else if (name == "heap-dump-at") {
+                    result.heap_dump_at = require_uint();
+                } else if (name == "heap-dump-graph") {
+                    result.heap_dump_graph = true;
+                } else if (name == "async-output") {
+                    result.async_output = true;
+                } else if (name == "bulk-input") {
+                    result.bulk_input = true;
+                } else if (name == "max-stack") {
+                    result.max_stack = require_uint();
+                } else if (name == "max-call-depth") {
+                    result.max_call_depth = require_uint();
+                } else if (name == "stack-prealloc") {
+                    result.stack_prealloc = require_uint();
+                } else if (name == "profile") {
+                    result.profile_file = require_value();
+                } else if (name == "output") {
+                    result.output_file = require_value();
+                } else if (name == "strip-lines") {
+                    result.strip_lines = true;
+                } else if (name == "json") {
+                    result.json = true;
+#ifndef DYNAMIC_VERIFICATION
+                } else if (name == "scalar-replace") {
+                    result.scalar_replace = true;
+#endif
+#ifdef CALL_GRAPH_PROFILER
+                } else if (name == "callgrind-out") {
+                    result.callgrind_file = require_value();
+#endif
+#ifdef COVERAGE
+                } else if (name == "coverage-out") {
+                    result.coverage_file = require_value();
+#endif
+#ifdef RUNTIME_METRICS
+                } else if (name == "metrics") {
+                    result.metrics_file = require_value();
+                } else if (name == "metrics-interval") {
+                    result.metrics_interval = std::chrono::milliseconds(require_uint());
+#endif
+#if INTERPRETER_TRACE
+                } else if (name == "trace-file") {
+                    result.trace_file = require_value();
+                } else if (name == "trace-capacity") {
+                    result.trace_capacity = require_uint();
+#endif
                 } else {
                     std::println(std::cerr, "Unrecognized option: {}", arg);
                     std::println(std::cerr, "{}", usage);
@@ -120,5 +338,21 @@ Args Args::parse_or_exit(int argc, char **argv) {
         exit(2);
     }
 
+    if (result.mode == Mode::Relayout && (!result.profile_file || !result.output_file)) {
+        std::println(std::cerr, "The relayout mode requires --profile and --output.");
+        std::println(std::cerr, "{}", usage);
+
+        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+        exit(2);
+    }
+
+    if (result.mode == Mode::Strip && !result.output_file) {
+        std::println(std::cerr, "The strip mode requires --output.");
+        std::println(std::cerr, "{}", usage);
+
+        // NOLINTNEXTLINE(concurrency-mt-unsafe)
+        exit(2);
+    }
+
     return result;
 }
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <filesystem>
+#include <optional>
+
+#include "config.hpp"
 
 namespace friar::args {
 
@@ -10,12 +14,55 @@ enum class Mode : uint8_t {
     Verify,
     Idiom,
     Run,
+    DecodeTrace,
+    Relayout,
+    Strip,
+    Stats,
 };
 
 struct Args {
     std::filesystem::path input_file;
     Mode mode = Mode::Run;
     bool time = false;
+    bool gc_stats = false;
+    bool mem = false;
+    std::optional<std::filesystem::path> trace_events_file;
+    std::optional<std::chrono::microseconds> trace_call_threshold;
+    std::optional<std::filesystem::path> alloc_profile_file;
+    std::optional<std::filesystem::path> heap_dump_file;
+    std::optional<uint64_t> heap_dump_at;
+    bool heap_dump_graph = false;
+    bool async_output = false;
+    bool bulk_input = false;
+    std::optional<uint64_t> max_stack;
+    std::optional<uint64_t> max_call_depth;
+    uint64_t stack_prealloc = 0;
+    std::optional<std::filesystem::path> profile_file;
+    std::optional<std::filesystem::path> output_file;
+    bool strip_lines = false;
+    bool json = false;
+
+#ifndef DYNAMIC_VERIFICATION
+    bool scalar_replace = false;
+#endif
+
+#ifdef CALL_GRAPH_PROFILER
+    std::optional<std::filesystem::path> callgrind_file;
+#endif
+
+#ifdef COVERAGE
+    std::optional<std::filesystem::path> coverage_file;
+#endif
+
+#ifdef RUNTIME_METRICS
+    std::optional<std::filesystem::path> metrics_file;
+    std::chrono::milliseconds metrics_interval{1000};
+#endif
+
+#if INTERPRETER_TRACE
+    std::filesystem::path trace_file = "friar.trace";
+    uint64_t trace_capacity = uint64_t(1) << 20;
+#endif
 
     static Args parse_or_exit(int argc, char **argv);
 };
@@ -0,0 +1,125 @@
+#include "async_output.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include "util.hpp"
+
+using namespace friar;
+using namespace friar::async_output;
+
+namespace {
+
+// the put area never spans more than this many bytes, so the writer thread is handed data in
+// chunks of at most this size even if the ring is much larger.
+constexpr size_t max_chunk_size = 64 * 1024;
+
+} // namespace
+
+Buf::Buf(int fd, size_t capacity)
+    : fd_(fd)
+    , capacity_(std::bit_ceil(std::max(capacity, max_chunk_size)))
+    , data_(std::make_unique<char[]>(capacity_)) {
+    thread_ = std::thread([this] { run(); });
+}
+
+Buf::~Buf() {
+    sync();
+    head_.fetch_or(closed_bit, std::memory_order_release);
+    head_.notify_one();
+    thread_.join();
+}
+
+Buf::int_type Buf::overflow(int_type ch) {
+    publish();
+    acquire();
+
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return traits_type::not_eof(ch);
+    }
+
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+
+    return ch;
+}
+
+int Buf::sync() {
+    publish();
+
+    auto head = head_.load(std::memory_order_relaxed) & ~closed_bit;
+
+    for (auto tail = tail_.load(std::memory_order_acquire); tail != head;
+         tail = tail_.load(std::memory_order_acquire)) {
+        tail_.wait(tail, std::memory_order_acquire);
+    }
+
+    return failed_.load(std::memory_order_relaxed) ? -1 : 0;
+}
+
+void Buf::publish() noexcept {
+    auto len = static_cast<uint64_t>(pptr() - pbase());
+
+    if (len == 0) {
+        return;
+    }
+
+    // the producer is the only thread that modifies `head_` before closing.
+    head_.store(head_.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    head_.notify_one();
+
+    // the rest of the put area is still free.
+    setp(pptr(), epptr());
+}
+
+void Buf::acquire() noexcept {
+    auto head = head_.load(std::memory_order_relaxed);
+
+    while (true) {
+        auto tail = tail_.load(std::memory_order_acquire);
+        auto free = capacity_ - static_cast<size_t>(head - tail);
+
+        if (free > 0) {
+            auto start = static_cast<size_t>(head & (capacity_ - 1));
+            auto len = std::min({free, capacity_ - start, max_chunk_size});
+            setp(data_.get() + start, data_.get() + start + len);
+
+            return;
+        }
+
+        // the ring is full: wait for the writer thread to catch up.
+        tail_.wait(tail, std::memory_order_acquire);
+    }
+}
+
+void Buf::run() noexcept {
+    uint64_t tail = 0;
+
+    while (true) {
+        auto head = head_.load(std::memory_order_acquire);
+        auto end = head & ~closed_bit;
+
+        if (tail == end) {
+            if (head & closed_bit) {
+                return;
+            }
+
+            head_.wait(head, std::memory_order_acquire);
+
+            continue;
+        }
+
+        auto start = static_cast<size_t>(tail & (capacity_ - 1));
+        auto len = std::min(static_cast<size_t>(end - tail), capacity_ - start);
+
+        // after a failed write, the data is discarded so that the producer never blocks forever.
+        if (!failed_.load(std::memory_order_relaxed)
+            && !util::write_all(fd_, data_.get() + start, len)) {
+            failed_.store(true, std::memory_order_relaxed);
+        }
+
+        tail += len;
+        tail_.store(tail, std::memory_order_release);
+        tail_.notify_one();
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <streambuf>
+#include <thread>
+
+namespace friar::async_output {
+
+/// An output stream buffer whose data is written to a file descriptor by a background thread.
+///
+/// The stream writes directly into a single-producer single-consumer ring buffer, and the writer
+/// thread drains it. Writing only blocks when the ring is full.
+///
+/// Flushing the stream (`sync()`) waits until everything written so far has reached the file
+/// descriptor, so flushing before reading input keeps prompts and input in order, and flushing
+/// before writing to another stream keeps the two in order.
+class Buf : public std::streambuf {
+public:
+    /// Starts a writer thread for `fd`. `capacity` is rounded up to a power of two.
+    explicit Buf(int fd, size_t capacity = size_t(1) << 20);
+
+    Buf(const Buf &) = delete;
+    Buf &operator=(const Buf &) = delete;
+
+    /// Flushes the buffer and stops the writer thread.
+    ~Buf() override;
+
+protected:
+    int_type overflow(int_type ch) override;
+    int sync() override;
+
+private:
+    // set in `head_` once the producer is done.
+    static constexpr uint64_t closed_bit = uint64_t(1) << 63;
+
+    // hands the written part of the put area over to the writer thread.
+    void publish() noexcept;
+
+    // points the put area at the next free part of the ring, waiting for one if necessary.
+    void acquire() noexcept;
+
+    void run() noexcept;
+
+    int fd_;
+    size_t capacity_;
+    std::unique_ptr<char[]> data_;
+
+    // the total number of bytes published by the producer (and `closed_bit`).
+    std::atomic<uint64_t> head_ = 0;
+
+    // the total number of bytes consumed by the writer thread.
+    std::atomic<uint64_t> tail_ = 0;
+
+    std::atomic<bool> failed_ = false;
+    std::thread thread_;
+};
+
+} // namespace friar::async_output
@@ -0,0 +1,143 @@
+#include "bulk_input.hpp"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include "rewrite.hpp"
+#include "util.hpp"
+
+using namespace friar;
+using friar::bytecode::Instr;
+
+namespace {
+
+using Builtin = std::pair<std::string_view, Instr>;
+
+constexpr std::array<Builtin, 3> builtins = {{
+    {"readAll", Instr::CallLreadAll},
+    {"readLine", Instr::CallLreadLine},
+    {"readFile", Instr::CallLreadFile},
+}};
+
+// returns the name of a symbol, unless it is not a valid string table entry (the module has not
+// been verified yet).
+std::optional<std::string_view> symbol_name(const bytecode::Module &mod, const bytecode::Sym &sym) {
+    if (sym.name >= mod.strtab.size()) {
+        return std::nullopt;
+    }
+
+    auto begin = mod.strtab.begin() + sym.name;
+    auto end = std::find(begin, mod.strtab.end(), '\0');
+
+    if (end == mod.strtab.end()) {
+        return std::nullopt;
+    }
+
+    return std::string_view(begin, end);
+}
+
+// overwrites a procedure body (the bytes following its BEGIN, starting at `addr`) with
+// `builtin; END`.
+//
+// the verifier expects END to be followed by the next procedure, so it is placed last. the bytes
+// before are either skipped with a jump (and filled with DROP so that the body still decodes) or,
+// if there are too few for a jump, filled with DUP; DROP pairs.
+bool replace_body(std::span<Instr> body, uint32_t addr, Instr builtin) {
+    constexpr size_t jmp_len = 1 + sizeof(uint32_t);
+
+    if (body.size() < 2) {
+        return false;
+    }
+
+    auto tail = body.size() - 2;
+
+    if (tail >= jmp_len) {
+        std::ranges::fill(body.first(tail), Instr::Drop);
+        body[0] = Instr::Jmp;
+        util::to_u32_le(
+            std::as_writable_bytes(body.subspan<1, sizeof(uint32_t)>()),
+            addr + static_cast<uint32_t>(tail)
+        );
+        body[tail] = builtin;
+    } else if (tail % 2 == 0) {
+        body[0] = builtin;
+
+        for (size_t i = 1; i < tail; i += 2) {
+            body[i] = Instr::Dup;
+            body[i + 1] = Instr::Drop;
+        }
+    } else {
+        return false;
+    }
+
+    body[tail + 1] = Instr::End;
+
+    return true;
+}
+
+} // namespace
+
+std::expected<uint32_t, std::string> friar::bulk_input::bind(bytecode::Module &mod) {
+    std::optional<rewrite::Code> code;
+    uint32_t result = 0;
+
+    for (const auto &sym : mod.symtab) {
+        auto name = symbol_name(mod, sym);
+
+        if (!name) {
+            continue;
+        }
+
+        auto builtin = std::ranges::find(builtins, *name, &Builtin::first);
+
+        if (builtin == builtins.end()) {
+            continue;
+        }
+
+        if (!code) {
+            auto r = rewrite::decode_code(mod);
+
+            if (!r) {
+                return std::unexpected(std::move(r).error());
+            }
+
+            code = std::move(*r);
+        }
+
+        const auto *proc = code->proc_at(sym.address);
+
+        if (!proc || proc->addr != sym.address) {
+            return std::unexpected(std::format("{} does not refer to a procedure", *name));
+        }
+
+        const auto &begin = code->instrs[proc->first];
+
+        if (begin.opcode != Instr::Begin) {
+            return std::unexpected(std::format("{} must not close over variables", *name));
+        }
+
+        auto params_bytes = std::as_bytes(std::span(mod.bytecode).subspan(begin.addr + 1, 4));
+        auto params = util::from_u32_le(std::span<const std::byte, 4>(params_bytes));
+
+        if (params != 0) {
+            return std::unexpected(
+                std::format("{} must take no parameters, but it takes {}", *name, params)
+            );
+        }
+
+        auto body = std::span(mod.bytecode).subspan(begin.end, proc->end - begin.end);
+
+        if (!replace_body(body, begin.end, builtin->second)) {
+            return std::unexpected(std::format("the body of {} cannot be replaced", *name));
+        }
+
+        ++result;
+    }
+
+    return result;
+}
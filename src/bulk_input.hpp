@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <string>
+
+#include "bytecode.hpp"
+
+namespace friar::bulk_input {
+
+/// Replaces the bodies of the public procedures `readAll`, `readLine`, and `readFile` with the
+/// bulk input instructions `CALL Lreadall`, `CALL Lreadline`, and `CALL Lreadfile`.
+///
+/// The Lama compiler never emits these instructions, so programs declare the procedures
+/// themselves (with portable bodies, e.g., built on `read`), and the bodies are swapped out after
+/// loading. This also covers calls through closures of the procedures. The procedures must take
+/// no parameters and must not close over variables.
+///
+/// Must be applied before verification. Returns the number of replaced procedures.
+std::expected<uint32_t, std::string> bind(bytecode::Module &mod);
+
+} // namespace friar::bulk_input
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -75,6 +76,17 @@ enum class Instr : uint8_t {
     CallLlength = 0x72, // `CALL Llength`.
     CallLstring = 0x73, // `CALL Lstring`.
     CallBarray = 0x74, // `CALL Barray`.
+    CallLreadAll = 0x75, // `CALL Lreadall`.
+    CallLreadLine = 0x76, // `CALL Lreadline`.
+    CallLreadFile = 0x77, // `CALL Lreadfile`.
+
+    // never read from a file: these replace the instructions that return and destructure a tuple
+    // (see `tuple_return::scalar_replace`) and keep their immediates.
+    Values = 0x78, // `CALL Barray n`, passing the elements to the caller instead.
+    SexpValues = 0x79, // `SEXP s n`, passing the members to the caller instead.
+    ElemValue = 0x7a, // `ELEM`, reading a value passed by the callee.
+    ArrayValues = 0x7b, // `ARRAY n`, matching the values passed by the callee.
+    TagValues = 0x7c, // `TAG s n`, matching the values passed by the callee.
 
     Eof = 0xff, // End-of-file marker.
 };
@@ -116,9 +128,20 @@ struct Module {
     /// The program bytecode (includes the end-of-file marker).
     std::vector<Instr> bytecode;
 
-    std::string_view strtab_entry_at(uint32_t offset) {
+    std::string_view strtab_entry_at(uint32_t offset) const {
         return &strtab.at(offset);
     }
+
+    /// Returns the name of the public symbol defined at `address`, if there is one.
+    std::optional<std::string_view> symbol_at(uint32_t address) const {
+        for (const auto &sym : symtab) {
+            if (sym.address == address) {
+                return strtab_entry_at(sym.name);
+            }
+        }
+
+        return std::nullopt;
+    }
 };
 
 } // namespace friar::bytecode
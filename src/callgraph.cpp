@@ -0,0 +1,146 @@
+#include "callgraph.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace friar;
+using namespace friar::callgraph;
+using friar::bytecode::Instr;
+
+CallGraph friar::callgraph::build(const rewrite::Code &code) {
+    CallGraph graph;
+
+    for (const auto &proc : code.procs) {
+        auto &callees = graph.callees[proc.addr];
+
+        for (size_t i = proc.first; i < proc.last; ++i) {
+            const auto &instr = code.instrs[i];
+
+            if (instr.opcode == Instr::Call || instr.opcode == Instr::Closure) {
+                callees.push_back(instr.target);
+            }
+        }
+
+        std::ranges::sort(callees);
+        callees.erase(std::ranges::unique(callees).begin(), callees.end());
+    }
+
+    return graph;
+}
+
+std::set<uint32_t>
+friar::callgraph::reachable(const CallGraph &graph, std::span<const uint32_t> roots) {
+    std::set<uint32_t> result;
+    std::vector<uint32_t> to_visit(roots.begin(), roots.end());
+
+    while (!to_visit.empty()) {
+        auto addr = to_visit.back();
+        to_visit.pop_back();
+
+        if (!result.insert(addr).second) {
+            continue;
+        }
+
+        if (auto it = graph.callees.find(addr); it != graph.callees.end()) {
+            to_visit.insert(to_visit.end(), it->second.begin(), it->second.end());
+        }
+    }
+
+    return result;
+}
+
+std::set<uint32_t> friar::callgraph::recursive(const CallGraph &graph) {
+    // Tarjan's strongly connected components algorithm, with an explicit stack.
+    struct NodeState {
+        uint32_t index = 0;
+        uint32_t lowlink = 0;
+        bool on_stack = false;
+    };
+
+    struct Frame {
+        uint32_t addr = 0;
+        size_t next_callee = 0;
+    };
+
+    static const std::vector<uint32_t> no_callees;
+
+    auto callees_of = [&](uint32_t addr) -> const std::vector<uint32_t> & {
+        auto it = graph.callees.find(addr);
+
+        return it == graph.callees.end() ? no_callees : it->second;
+    };
+
+    std::set<uint32_t> result;
+    std::unordered_map<uint32_t, NodeState> state;
+    std::vector<uint32_t> component;
+    std::vector<Frame> frames;
+    uint32_t next_index = 0;
+
+    auto visit = [&](uint32_t addr) {
+        state[addr] = NodeState{
+            .index = next_index,
+            .lowlink = next_index,
+            .on_stack = true,
+        };
+        ++next_index;
+        component.push_back(addr);
+        frames.push_back(Frame{.addr = addr});
+    };
+
+    for (const auto &[root, _] : graph.callees) {
+        if (state.contains(root)) {
+            continue;
+        }
+
+        visit(root);
+
+        while (!frames.empty()) {
+            auto &frame = frames.back();
+            const auto &callees = callees_of(frame.addr);
+
+            if (frame.next_callee < callees.size()) {
+                auto caller = frame.addr;
+                auto callee = callees[frame.next_callee++];
+
+                if (auto it = state.find(callee); it == state.end()) {
+                    visit(callee);
+                } else if (it->second.on_stack) {
+                    auto &caller_state = state[caller];
+                    caller_state.lowlink = std::min(caller_state.lowlink, it->second.index);
+                }
+
+                continue;
+            }
+
+            auto addr = frame.addr;
+            frames.pop_back();
+            auto node = state[addr];
+
+            if (!frames.empty()) {
+                auto &parent = state[frames.back().addr];
+                parent.lowlink = std::min(parent.lowlink, node.lowlink);
+            }
+
+            if (node.lowlink != node.index) {
+                continue;
+            }
+
+            // `addr` is the root of a component: pop it.
+            auto first = std::ranges::find(component, addr);
+            bool cyclic = std::next(first) != component.end()
+                || std::ranges::binary_search(callees_of(addr), addr);
+
+            for (auto it = first; it != component.end(); ++it) {
+                state[*it].on_stack = false;
+
+                if (cyclic) {
+                    result.insert(*it);
+                }
+            }
+
+            component.erase(first, component.end());
+        }
+    }
+
+    return result;
+}
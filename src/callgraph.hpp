@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <span>
+#include <vector>
+
+#include "rewrite.hpp"
+
+namespace friar::callgraph {
+
+/// A static call graph.
+///
+/// A procedure refers to another if it calls it directly or instantiates a closure of it (which
+/// may then be called from anywhere).
+struct CallGraph {
+    /// The procedures each procedure refers to, keyed by address. Sorted and deduplicated.
+    std::map<uint32_t, std::vector<uint32_t>> callees;
+};
+
+CallGraph build(const rewrite::Code &code);
+
+/// Returns the addresses of the procedures reachable from `roots`, including the roots themselves.
+std::set<uint32_t> reachable(const CallGraph &graph, std::span<const uint32_t> roots);
+
+/// Returns the addresses of the procedures that may call themselves, directly or through other
+/// procedures (i.e., those in a cycle of the call graph).
+std::set<uint32_t> recursive(const CallGraph &graph);
+
+} // namespace friar::callgraph
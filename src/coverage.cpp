@@ -0,0 +1,146 @@
+#include "coverage.hpp"
+
+#include <filesystem>
+#include <format>
+#include <map>
+#include <print>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "decode.hpp"
+#include "util.hpp"
+
+using namespace friar;
+using namespace friar::coverage;
+using friar::bytecode::Instr;
+
+namespace {
+
+struct Proc {
+    std::string name;
+    uint32_t first_line = 0;
+    bool hit = false;
+};
+
+} // namespace
+
+Summary friar::coverage::write_lcov(
+    const bytecode::Module &mod,
+    std::span<const uint8_t> hits,
+    std::ostream &s
+) {
+    Summary summary;
+    decode::Decoder decoder(mod.bytecode);
+    std::vector<Proc> procs;
+
+    // line -> whether any instruction attributed to it was executed.
+    std::map<uint32_t, bool> lines;
+    uint32_t line = 0;
+    Instr opcode = Instr::Eof;
+    bool done = false;
+
+    auto is_hit = [&](uint32_t addr) { return addr < hits.size() && hits[addr] != 0; };
+
+    while (!done && decoder.pos() < mod.bytecode.size()) {
+        decoder.next([&](const decode::Decoder::Result &result) {
+            std::visit(
+                util::overloaded{
+                    [&](const decode::InstrStart &start) {
+                        opcode = start.opcode;
+
+                        switch (start.opcode) {
+                        case Instr::Begin:
+                        case Instr::Cbegin: {
+                            auto name = mod.symbol_at(start.addr);
+                            line = 0;
+                            procs.push_back(
+                                Proc{
+                                    .name = name ? std::string(*name)
+                                                 : std::format("<anon {:#x}>", start.addr),
+                                    .hit = is_hit(start.addr),
+                                }
+                            );
+
+                            break;
+                        }
+
+                        case Instr::Eof:
+                            done = true;
+                            return;
+
+                        default:
+                            break;
+                        }
+
+                        ++summary.instrs;
+
+                        if (is_hit(start.addr)) {
+                            ++summary.instrs_hit;
+                        }
+                    },
+
+                    [&](const decode::Imm32 &imm) {
+                        if (opcode != Instr::Line || imm.imm == 0) {
+                            return;
+                        }
+
+                        line = imm.imm;
+
+                        if (!procs.empty() && procs.back().first_line == 0) {
+                            procs.back().first_line = line;
+                        }
+                    },
+
+                    [&](const decode::InstrEnd &end) {
+                        if (line != 0 && !done) {
+                            lines[line] = lines[line] || is_hit(end.start);
+                        }
+                    },
+
+                    [&](const decode::Error &) { done = true; },
+
+                    [](const auto &) {},
+                },
+                result
+            );
+        });
+    }
+
+    auto source = std::filesystem::path(mod.name).replace_extension(".lama");
+
+    std::println(s, "TN:");
+    std::println(s, "SF:{}", source.native());
+
+    for (const auto &proc : procs) {
+        if (proc.first_line != 0) {
+            std::println(s, "FN:{},{}", proc.first_line, proc.name);
+        }
+    }
+
+    uint32_t procs_found = 0;
+    uint32_t procs_hit = 0;
+
+    for (const auto &proc : procs) {
+        if (proc.first_line != 0) {
+            std::println(s, "FNDA:{},{}", proc.hit ? 1 : 0, proc.name);
+            ++procs_found;
+            procs_hit += proc.hit ? 1 : 0;
+        }
+    }
+
+    std::println(s, "FNF:{}", procs_found);
+    std::println(s, "FNH:{}", procs_hit);
+
+    for (auto [ln, hit] : lines) {
+        std::println(s, "DA:{},{}", ln, hit ? 1 : 0);
+        ++summary.lines;
+        summary.lines_hit += hit ? 1 : 0;
+    }
+
+    std::println(s, "LF:{}", summary.lines);
+    std::println(s, "LH:{}", summary.lines_hit);
+    std::println(s, "end_of_record");
+
+    return summary;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <span>
+
+#include "bytecode.hpp"
+
+namespace friar::coverage {
+
+/// Coverage totals for a module.
+struct Summary {
+    uint32_t instrs = 0;
+    uint32_t instrs_hit = 0;
+    uint32_t lines = 0;
+    uint32_t lines_hit = 0;
+};
+
+/// Writes the coverage of `mod` in the lcov tracefile format.
+///
+/// `hits` has an entry for each byte of the bytecode, which is non-zero if an instruction starting
+/// at that address was executed. Instructions are attributed to the source line set by the
+/// preceding `LINE` instruction in the same procedure.
+Summary write_lcov(const bytecode::Module &mod, std::span<const uint8_t> hits, std::ostream &s);
+
+} // namespace friar::coverage
@@ -13,6 +13,7 @@
 
 #include "bytecode.hpp"
 #include "util.hpp"
+#include "verifier.hpp"
 
 namespace friar::decode {
 
@@ -202,6 +203,10 @@ void Decoder::next(const F &listener) {
     case bytecode::Instr::CallLwrite:
     case bytecode::Instr::CallLlength:
     case bytecode::Instr::CallLstring:
+    case bytecode::Instr::CallLreadAll:
+    case bytecode::Instr::CallLreadLine:
+    case bytecode::Instr::CallLreadFile:
+    case bytecode::Instr::ElemValue:
     case bytecode::Instr::Eof:
         break;
 
@@ -214,6 +219,7 @@ void Decoder::next(const F &listener) {
         break;
 
     case bytecode::Instr::Sexp:
+    case bytecode::Instr::SexpValues:
         r = read_imm32("tag")
                 .transform(listener)
                 .and_then([&] { return read_imm32("member count"); })
@@ -259,9 +265,12 @@ void Decoder::next(const F &listener) {
                 .and_then([&](auto n) {
                     listener(n);
 
+                    // a verified module may store a closure site index in the upper bits.
+                    auto captures = (n.imm & verifier::closure_site_flag) != 0 ? n.imm & 0xffff
+                                                                                : n.imm;
                     std::expected<void, Error> r;
 
-                    for (size_t i = 0; i < n.imm && r; ++i) {
+                    for (size_t i = 0; i < captures && r; ++i) {
                         r = read_imm_varspec(false).transform(listener);
                     }
 
@@ -283,6 +292,7 @@ void Decoder::next(const F &listener) {
         break;
 
     case bytecode::Instr::Tag:
+    case bytecode::Instr::TagValues:
         r = read_imm32("tag")
                 .transform(listener)
                 .and_then([&] { return read_imm32("member count"); })
@@ -292,6 +302,8 @@ void Decoder::next(const F &listener) {
 
     case bytecode::Instr::Array:
     case bytecode::Instr::CallBarray:
+    case bytecode::Instr::Values:
+    case bytecode::Instr::ArrayValues:
         r = read_imm32("element count").transform(listener);
         break;
 
@@ -9,251 +9,230 @@
 using namespace friar;
 using namespace friar::disas;
 
-void friar::disas::disassemble(
-    std::span<const bytecode::Instr> bc,
-    std::ostream &s,
-    DisasOpts opts
-) {
-    decode::Decoder decoder(bc);
-    auto width = util::compute_decimal_width(bc.size_bytes());
-    bool first = true;
+std::string_view friar::disas::opcode_name(bytecode::Instr opcode) noexcept {
+    using bytecode::Instr;
 
-    while (decoder.pos() < bc.size()) {
-        decoder.next([&](const decode::Decoder::Result &result) {
-            std::visit(
-                util::overloaded{
-                    [&](const decode::InstrStart &start) {
-                        if (!first) {
-                            s << opts.instr_sep;
-                        }
+    switch (opcode) {
+    case Instr::Add:
+        return "binop +";
 
-                        first = false;
+    case Instr::Sub:
+        return "binop -";
 
-                        if (opts.print_addr) {
-                            std::print(s, "{:>{}x}:  ", start.addr, width);
-                        }
+    case Instr::Mul:
+        return "binop *";
 
-                        switch (start.opcode) {
-                        case bytecode::Instr::Add:
-                            s << "binop +";
-                            break;
+    case Instr::Div:
+        return "binop /";
 
-                        case bytecode::Instr::Sub:
-                            s << "binop -";
-                            break;
+    case Instr::Mod:
+        return "binop %";
 
-                        case bytecode::Instr::Mul:
-                            s << "binop *";
-                            break;
+    case Instr::Lt:
+        return "binop <";
 
-                        case bytecode::Instr::Div:
-                            s << "binop /";
-                            break;
+    case Instr::Le:
+        return "binop <=";
 
-                        case bytecode::Instr::Mod:
-                            s << "binop %";
-                            break;
+    case Instr::Gt:
+        return "binop >";
 
-                        case bytecode::Instr::Lt:
-                            s << "binop <";
-                            break;
+    case Instr::Ge:
+        return "binop >=";
 
-                        case bytecode::Instr::Le:
-                            s << "binop <=";
-                            break;
+    case Instr::Eq:
+        return "binop ==";
 
-                        case bytecode::Instr::Gt:
-                            s << "binop >";
-                            break;
+    case Instr::Ne:
+        return "binop !=";
 
-                        case bytecode::Instr::Ge:
-                            s << "binop >=";
-                            break;
+    case Instr::And:
+        return "binop &&";
 
-                        case bytecode::Instr::Eq:
-                            s << "binop ==";
-                            break;
+    case Instr::Or:
+        return "binop !!";
 
-                        case bytecode::Instr::Ne:
-                            s << "binop !=";
-                            break;
+    case Instr::Const:
+        return "const";
 
-                        case bytecode::Instr::And:
-                            s << "binop &&";
-                            break;
+    case Instr::String:
+        return "string";
 
-                        case bytecode::Instr::Or:
-                            s << "binop !!";
-                            break;
+    case Instr::Sexp:
+        return "sexp";
 
-                        case bytecode::Instr::Const:
-                            s << "const";
-                            break;
+    case Instr::Sti:
+        return "sti";
 
-                        case bytecode::Instr::String:
-                            s << "string";
-                            break;
+    case Instr::Sta:
+        return "sta";
 
-                        case bytecode::Instr::Sexp:
-                            s << "sexp";
-                            break;
+    case Instr::Jmp:
+        return "jmp";
 
-                        case bytecode::Instr::Sti:
-                            s << "sti";
-                            break;
+    case Instr::End:
+        return "end";
 
-                        case bytecode::Instr::Sta:
-                            s << "sta";
-                            break;
+    case Instr::Ret:
+        return "ret";
 
-                        case bytecode::Instr::Jmp:
-                            s << "jmp";
-                            break;
+    case Instr::Drop:
+        return "drop";
 
-                        case bytecode::Instr::End:
-                            s << "end";
-                            break;
+    case Instr::Dup:
+        return "dup";
 
-                        case bytecode::Instr::Ret:
-                            s << "ret";
-                            break;
+    case Instr::Swap:
+        return "swap";
 
-                        case bytecode::Instr::Drop:
-                            s << "drop";
-                            break;
+    case Instr::Elem:
+        return "elem";
 
-                        case bytecode::Instr::Dup:
-                            s << "dup";
-                            break;
+    case Instr::LdG:
+    case Instr::LdL:
+    case Instr::LdA:
+    case Instr::LdC:
+        return "ld";
 
-                        case bytecode::Instr::Swap:
-                            s << "swap";
-                            break;
+    case Instr::LdaG:
+    case Instr::LdaL:
+    case Instr::LdaA:
+    case Instr::LdaC:
+        return "lda";
 
-                        case bytecode::Instr::Elem:
-                            s << "elem";
-                            break;
+    case Instr::StG:
+    case Instr::StL:
+    case Instr::StA:
+    case Instr::StC:
+        return "st";
 
-                        case bytecode::Instr::LdG:
-                        case bytecode::Instr::LdL:
-                        case bytecode::Instr::LdA:
-                        case bytecode::Instr::LdC:
-                            s << "ld";
-                            break;
+    case Instr::CjmpZ:
+        return "cjmpz";
 
-                        case bytecode::Instr::LdaG:
-                        case bytecode::Instr::LdaL:
-                        case bytecode::Instr::LdaA:
-                        case bytecode::Instr::LdaC:
-                            s << "lda";
-                            break;
+    case Instr::CjmpNz:
+        return "cjmpnz";
 
-                        case bytecode::Instr::StG:
-                        case bytecode::Instr::StL:
-                        case bytecode::Instr::StA:
-                        case bytecode::Instr::StC:
-                            s << "st";
-                            break;
+    case Instr::Begin:
+        return "begin";
 
-                        case bytecode::Instr::CjmpZ:
-                            s << "cjmpz";
-                            break;
+    case Instr::Cbegin:
+        return "cbegin";
 
-                        case bytecode::Instr::CjmpNz:
-                            s << "cjmpnz";
-                            break;
+    case Instr::Closure:
+        return "closure";
 
-                        case bytecode::Instr::Begin:
-                            s << "begin";
-                            break;
+    case Instr::CallC:
+        return "callc";
 
-                        case bytecode::Instr::Cbegin:
-                            s << "cbegin";
-                            break;
+    case Instr::Call:
+        return "call";
 
-                        case bytecode::Instr::Closure:
-                            s << "closure";
-                            break;
+    case Instr::Tag:
+        return "tag";
 
-                        case bytecode::Instr::CallC:
-                            s << "callc";
-                            break;
+    case Instr::Array:
+        return "array";
 
-                        case bytecode::Instr::Call:
-                            s << "call";
-                            break;
+    case Instr::Fail:
+        return "fail";
 
-                        case bytecode::Instr::Tag:
-                            s << "tag";
-                            break;
+    case Instr::Line:
+        return "line";
 
-                        case bytecode::Instr::Array:
-                            s << "array";
-                            break;
+    case Instr::PattEqStr:
+        return "patt =str";
 
-                        case bytecode::Instr::Fail:
-                            s << "fail";
-                            break;
+    case Instr::PattString:
+        return "patt #str";
 
-                        case bytecode::Instr::Line:
-                            s << "line";
-                            break;
+    case Instr::PattArray:
+        return "patt #array";
 
-                        case bytecode::Instr::PattEqStr:
-                            s << "patt =str";
-                            break;
+    case Instr::PattSexp:
+        return "patt #sexp";
 
-                        case bytecode::Instr::PattString:
-                            s << "patt #str";
-                            break;
+    case Instr::PattRef:
+        return "patt #ref";
 
-                        case bytecode::Instr::PattArray:
-                            s << "patt #array";
-                            break;
+    case Instr::PattVal:
+        return "patt #val";
 
-                        case bytecode::Instr::PattSexp:
-                            s << "patt #sexp";
-                            break;
+    case Instr::PattFun:
+        return "patt #fun";
 
-                        case bytecode::Instr::PattRef:
-                            s << "patt #ref";
-                            break;
+    case Instr::CallLread:
+        return "call Lread";
 
-                        case bytecode::Instr::PattVal:
-                            s << "patt #val";
-                            break;
+    case Instr::CallLwrite:
+        return "call Lwrite";
 
-                        case bytecode::Instr::PattFun:
-                            s << "patt #fun";
-                            break;
+    case Instr::CallLlength:
+        return "call Llength";
 
-                        case bytecode::Instr::CallLread:
-                            s << "call Lread";
-                            break;
+    case Instr::CallLstring:
+        return "call Lstring";
 
-                        case bytecode::Instr::CallLwrite:
-                            s << "call Lwrite";
-                            break;
+    case Instr::CallBarray:
+        return "call Barray";
 
-                        case bytecode::Instr::CallLlength:
-                            s << "call Llength";
-                            break;
+    case Instr::CallLreadAll:
+        return "call Lreadall";
 
-                        case bytecode::Instr::CallLstring:
-                            s << "call Lstring";
-                            break;
+    case Instr::CallLreadLine:
+        return "call Lreadline";
 
-                        case bytecode::Instr::CallBarray:
-                            s << "call Barray";
-                            break;
+    case Instr::CallLreadFile:
+        return "call Lreadfile";
 
-                        case bytecode::Instr::Eof:
-                            s << "<eof>";
-                            break;
+    case Instr::Values:
+    case Instr::SexpValues:
+        return "values";
+
+    case Instr::ElemValue:
+        return "elem value";
+
+    case Instr::ArrayValues:
+        return "array values";
+
+    case Instr::TagValues:
+        return "tag values";
+
+    case Instr::Eof:
+        return "<eof>";
+
+    default:
+        return {};
+    }
+}
+
+void friar::disas::disassemble(
+    std::span<const bytecode::Instr> bc,
+    std::ostream &s,
+    DisasOpts opts
+) {
+    decode::Decoder decoder(bc);
+    auto width = util::compute_decimal_width(bc.size_bytes());
+    bool first = true;
+
+    while (decoder.pos() < bc.size()) {
+        decoder.next([&](const decode::Decoder::Result &result) {
+            std::visit(
+                util::overloaded{
+                    [&](const decode::InstrStart &start) {
+                        if (!first) {
+                            s << opts.instr_sep;
+                        }
 
-                        default:
+                        first = false;
+
+                        if (opts.print_addr) {
+                            std::print(s, "{:>{}x}:  ", start.addr, width);
+                        }
+
+                        if (auto name = opcode_name(start.opcode); !name.empty()) {
+                            s << name;
+                        } else {
                             std::print(s, "[illop {:#02x}]", static_cast<uint8_t>(start.opcode));
-                            break;
                         }
                     },
 
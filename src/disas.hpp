@@ -14,6 +14,9 @@ struct DisasOpts {
     std::string_view instr_sep;
 };
 
+/// Returns the mnemonic of `opcode` or an empty string if the opcode is illegal.
+std::string_view opcode_name(bytecode::Instr opcode) noexcept;
+
 void disassemble(std::span<const bytecode::Instr> bc, std::ostream &s, DisasOpts opts = {});
 
 } // namespace
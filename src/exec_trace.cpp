@@ -0,0 +1,223 @@
+#include "exec_trace.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <new>
+#include <print>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "disas.hpp"
+#include "util.hpp"
+
+using namespace friar;
+using namespace friar::exec_trace;
+
+std::expected<Tracer, std::error_code>
+Tracer::open(const std::filesystem::path &path, uint64_t capacity, bool record_tos) {
+    if (capacity > max_capacity) {
+        return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
+
+    // the ring buffer size must be a power of two; max_capacity keeps the map size in range.
+    capacity = std::bit_ceil(std::max<uint64_t>(capacity, 1));
+    auto flags = record_tos ? flag_tos : 0;
+    auto map_size = sizeof(Header) + capacity * record_stride(flags);
+
+    errno = 0;
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd < 0) {
+        return std::unexpected(util::get_last_error());
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(map_size)) != 0) {
+        auto e = util::get_last_error();
+        close(fd);
+
+        return std::unexpected(e);
+    }
+
+    auto *map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    auto e = util::get_last_error();
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        return std::unexpected(e);
+    }
+
+    new (map) Header{
+        .magic = magic,
+        .version = version,
+        .flags = flags,
+        .capacity = capacity,
+        .written = 0,
+    };
+
+    return Tracer(map, map_size);
+}
+
+Tracer::Tracer(void *map, size_t map_size) noexcept
+    : map_(map)
+    , map_size_(map_size)
+    , header_(static_cast<Header *>(map))
+    , records_(reinterpret_cast<std::byte *>(header_ + 1))
+    , stride_(record_stride(header_->flags)) {}
+
+Tracer::Tracer(Tracer &&other) noexcept
+    : map_(std::exchange(other.map_, nullptr))
+    , map_size_(other.map_size_)
+    , header_(other.header_)
+    , records_(other.records_)
+    , stride_(other.stride_) {}
+
+Tracer::~Tracer() {
+    if (map_) {
+        munmap(map_, map_size_);
+    }
+}
+
+namespace {
+
+// a read-only mapping of a whole file.
+class FileMap {
+public:
+    FileMap(const void *data, size_t size) noexcept : data_(data), size_(size) {}
+
+    FileMap(const FileMap &) = delete;
+    FileMap &operator=(const FileMap &) = delete;
+
+    ~FileMap() {
+        if (size_ > 0) {
+            munmap(const_cast<void *>(data_), size_);
+        }
+    }
+
+    const char *data() const noexcept {
+        return static_cast<const char *>(data_);
+    }
+
+    size_t size() const noexcept {
+        return size_;
+    }
+
+private:
+    const void *data_;
+    size_t size_;
+};
+
+} // namespace
+
+std::expected<void, std::string>
+friar::exec_trace::decode(const std::filesystem::path &path, std::ostream &s) {
+    auto fail = [&] {
+        return std::unexpected(
+            std::format("could not read {}: {}", path.c_str(), util::get_last_error().message())
+        );
+    };
+
+    // traces can be far larger than memory, so the file is mapped rather than read.
+    errno = 0;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return fail();
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) {
+        auto r = fail();
+        close(fd);
+
+        return r;
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    const void *map = nullptr;
+
+    if (size > 0) {
+        map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (map == MAP_FAILED) {
+            auto r = fail();
+            close(fd);
+
+            return r;
+        }
+
+        // the records are read in order.
+        madvise(const_cast<void *>(map), size, MADV_SEQUENTIAL);
+    }
+
+    close(fd);
+    FileMap contents(map, size);
+
+    Header header;
+
+    if (contents.size() < sizeof(header)) {
+        return std::unexpected("the file is too short to be a trace");
+    }
+
+    std::memcpy(&header, contents.data(), sizeof(header));
+
+    if (header.magic != magic) {
+        return std::unexpected("the file is not a trace");
+    }
+
+    if (header.version != version) {
+        return std::unexpected(std::format("unsupported trace version {}", header.version));
+    }
+
+    auto stride = record_stride(header.flags);
+
+    if (!std::has_single_bit(header.capacity) || header.capacity > max_capacity
+        || (contents.size() - sizeof(header)) / stride < header.capacity) {
+        return std::unexpected("the trace is truncated");
+    }
+
+    auto count = std::min(header.written, header.capacity);
+
+    if (header.written > count) {
+        std::println(s, "[{} earlier records were overwritten]", header.written - count);
+    }
+
+    for (auto i = header.written - count; i < header.written; ++i) {
+        const auto *src = contents.data() + sizeof(header) + (i & (header.capacity - 1)) * stride;
+        Record record;
+        std::memcpy(&record, src, sizeof(record));
+
+        auto opcode = static_cast<bytecode::Instr>(record.opcode);
+        auto name = disas::opcode_name(opcode);
+        std::print(s, "[{:#x}] op = {:#02x}", record.pc, record.opcode);
+
+        if (!name.empty()) {
+            std::print(s, " ({})", name);
+        }
+
+        std::print(s, " stack height = {}", record.stack_height);
+
+        if (header.flags & flag_tos) {
+            uint64_t tos = 0;
+            std::memcpy(&tos, src + sizeof(record), sizeof(tos));
+
+            if (tos & 1) {
+                // an unboxed integer.
+                std::print(s, " tos = {:#x} (int {})", tos, static_cast<int64_t>(tos) >> 1);
+            } else {
+                std::print(s, " tos = {:#x} (ref)", tos);
+            }
+        }
+
+        std::println(s, "");
+    }
+
+    return {};
+}
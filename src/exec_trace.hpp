@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <system_error>
+
+#include "bytecode.hpp"
+
+namespace friar::exec_trace {
+
+/// The trace file signature.
+constexpr std::array<char, 8> magic = {'F', 'R', 'I', 'A', 'R', 'T', 'R', 'C'};
+
+/// The trace file format version.
+constexpr uint32_t version = 2;
+
+/// Set in `Header::flags` if the records contain the value on top of the stack.
+constexpr uint32_t flag_tos = 1;
+
+/// The largest supported ring buffer capacity, in records.
+constexpr uint64_t max_capacity = uint64_t(1) << 32;
+
+/// The header of a trace file, followed by `capacity` records.
+struct Header {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t flags;
+
+    /// The number of records in the ring buffer (a power of two).
+    uint64_t capacity;
+
+    /// The total number of records written.
+    ///
+    /// Record `i` is stored at index `i % capacity`, so the file holds the last
+    /// `min(written, capacity)` records.
+    uint64_t written;
+};
+
+/// An executed instruction.
+///
+/// If `flag_tos` is set, each record is followed by the raw 8-byte value on top of the stack.
+struct Record {
+    uint32_t pc;
+
+    /// The height of the whole value stack (globals included) before the instruction executed.
+    uint32_t stack_height;
+
+    uint8_t opcode;
+};
+
+/// Returns the distance between consecutive records in a trace with the given header flags.
+constexpr size_t record_stride(uint32_t flags) noexcept {
+    return sizeof(Record) + (flags & flag_tos ? sizeof(uint64_t) : 0);
+}
+
+/// Records executed instructions into a ring buffer backed by a memory-mapped file.
+///
+/// The buffer lives in a shared mapping, so the last records survive even if the process is
+/// killed or crashes.
+class Tracer {
+public:
+    /// Creates (or truncates) the trace file at `path` with room for at least `capacity` records.
+    ///
+    /// Fails with `std::errc::invalid_argument` if `capacity` exceeds `max_capacity`.
+    static std::expected<Tracer, std::error_code>
+    open(const std::filesystem::path &path, uint64_t capacity, bool record_tos);
+
+    Tracer(Tracer &&other) noexcept;
+    Tracer &operator=(Tracer &&other) = delete;
+    ~Tracer();
+
+    bool records_tos() const noexcept {
+        return header_->flags & flag_tos;
+    }
+
+    void record(uint32_t pc, bytecode::Instr opcode, size_t stack_height, uint64_t tos) noexcept {
+        auto idx = header_->written++ & (header_->capacity - 1);
+        auto *dst = records_ + idx * stride_;
+
+        Record record{
+            .pc = pc,
+            .stack_height = static_cast<uint32_t>(stack_height),
+            .opcode = static_cast<uint8_t>(opcode),
+        };
+        std::memcpy(dst, &record, sizeof(record));
+
+        if (stride_ > sizeof(Record)) {
+            std::memcpy(dst + sizeof(Record), &tos, sizeof(tos));
+        }
+    }
+
+private:
+    Tracer(void *map, size_t map_size) noexcept;
+
+    void *map_;
+    size_t map_size_;
+    Header *header_;
+    std::byte *records_;
+    size_t stride_;
+};
+
+/// Decodes the trace file at `path`, writing the recorded instructions to `s`, one per line.
+std::expected<void, std::string> decode(const std::filesystem::path &path, std::ostream &s);
+
+} // namespace friar::exec_trace
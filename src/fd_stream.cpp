@@ -0,0 +1,99 @@
+#include "fd_stream.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "util.hpp"
+
+using namespace friar;
+using namespace friar::fd_stream;
+
+InBuf::InBuf(int fd, size_t capacity)
+    : fd_(fd)
+    , capacity_(capacity)
+    , data_(std::make_unique_for_overwrite<char[]>(capacity)) {
+    setg(data_.get(), data_.get(), data_.get());
+}
+
+InBuf::int_type InBuf::underflow() {
+    while (true) {
+        auto r = read(fd_, data_.get(), capacity_);
+
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (r <= 0) {
+            return traits_type::eof();
+        }
+
+        setg(data_.get(), data_.get(), data_.get() + r);
+
+        return traits_type::to_int_type(*gptr());
+    }
+}
+
+OutBuf::OutBuf(int fd, size_t capacity)
+    : fd_(fd)
+    , capacity_(capacity)
+    , data_(std::make_unique_for_overwrite<char[]>(capacity)) {
+    setp(data_.get(), data_.get() + capacity_);
+}
+
+OutBuf::~OutBuf() {
+    drain();
+}
+
+OutBuf::int_type OutBuf::overflow(int_type ch) {
+    if (!drain()) {
+        return traits_type::eof();
+    }
+
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize OutBuf::xsputn(const char *s, std::streamsize n) {
+    auto len = static_cast<size_t>(n);
+
+    if (len <= static_cast<size_t>(epptr() - pptr())) {
+        std::memcpy(pptr(), s, len);
+        pbump(static_cast<int>(len));
+
+        return n;
+    }
+
+    if (!drain()) {
+        return 0;
+    }
+
+    if (len < capacity_) {
+        std::memcpy(pptr(), s, len);
+        pbump(static_cast<int>(len));
+
+        return n;
+    }
+
+    return util::write_all(fd_, s, len) ? n : 0;
+}
+
+int OutBuf::sync() {
+    return drain() ? 0 : -1;
+}
+
+bool OutBuf::drain() noexcept {
+    auto len = static_cast<size_t>(pptr() - pbase());
+    setp(data_.get(), data_.get() + capacity_);
+
+    if (!failed_ && len > 0 && !util::write_all(fd_, data_.get(), len)) {
+        failed_ = true;
+    }
+
+    return !failed_;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <streambuf>
+
+namespace friar::fd_stream {
+
+/// An input stream buffer that reads from a file descriptor with plain `read` calls.
+///
+/// Unlike `std::cin`, it is not synchronized with C stdio, so reading costs no more than filling
+/// the buffer.
+class InBuf : public std::streambuf {
+public:
+    explicit InBuf(int fd, size_t capacity = 64 * 1024);
+
+    InBuf(const InBuf &) = delete;
+    InBuf &operator=(const InBuf &) = delete;
+
+protected:
+    int_type underflow() override;
+
+private:
+    int fd_;
+    size_t capacity_;
+    std::unique_ptr<char[]> data_;
+};
+
+/// An output stream buffer that writes to a file descriptor with plain `write` calls.
+///
+/// Unlike `std::cout`, it is not synchronized with C stdio: data is only written when the buffer
+/// fills up or the stream is flushed. Writes larger than the buffer bypass it.
+class OutBuf : public std::streambuf {
+public:
+    explicit OutBuf(int fd, size_t capacity = 64 * 1024);
+
+    OutBuf(const OutBuf &) = delete;
+    OutBuf &operator=(const OutBuf &) = delete;
+
+    /// Flushes the buffer.
+    ~OutBuf() override;
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+    int sync() override;
+
+private:
+    // writes out the contents of the put area and empties it.
+    bool drain() noexcept;
+
+    int fd_;
+    size_t capacity_;
+    std::unique_ptr<char[]> data_;
+
+    // set after a failed write; later data is discarded.
+    bool failed_ = false;
+};
+
+} // namespace friar::fd_stream
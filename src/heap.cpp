@@ -0,0 +1,175 @@
+#include "heap.hpp"
+
+#include <algorithm>
+#include <print>
+#include <utility>
+#include <vector>
+
+#include "disas.hpp"
+#include "runtime.hpp"
+
+using namespace friar;
+using namespace friar::heap;
+
+namespace {
+
+// rounds `size` up to a multiple of the word size, as done by the runtime's allocator.
+constexpr size_t round_to_word(size_t size) noexcept {
+    return (size + sizeof(auint) - 1) & ~(sizeof(auint) - 1);
+}
+
+} // namespace
+
+std::string_view friar::heap::kind_name(ObjectKind kind) noexcept {
+    switch (kind) {
+    case ObjectKind::String:
+        return "string";
+
+    case ObjectKind::Array:
+        return "array";
+
+    case ObjectKind::Sexp:
+        return "sexp";
+
+    case ObjectKind::Closure:
+        return "closure";
+    }
+
+    std::unreachable();
+}
+
+void SiteProfile::write(const bytecode::Module &mod, std::ostream &s) const {
+    std::vector<std::pair<uint32_t, Site>> sites(sites_.begin(), sites_.end());
+    std::ranges::sort(sites, [](const auto &lhs, const auto &rhs) {
+        return lhs.second.bytes != rhs.second.bytes ? lhs.second.bytes > rhs.second.bytes
+                                                    : lhs.first < rhs.first;
+    });
+
+    std::println(
+        s,
+        "{:>10}  {:<8}  {:>12}  {:>14}  {:>8}  {}",
+        "site",
+        "kind",
+        "objects",
+        "bytes",
+        "avg",
+        "instruction"
+    );
+
+    for (const auto &[site, entry] : sites) {
+        std::println(
+            s,
+            "{:>#10x}  {:<8}  {:>12}  {:>14}  {:>8}  {}",
+            site,
+            kind_name(entry.kind),
+            entry.objects,
+            entry.bytes,
+            entry.bytes / entry.objects,
+            site < mod.bytecode.size() ? disas::opcode_name(mod.bytecode[site]) : ""
+        );
+    }
+}
+
+size_t friar::heap::string_size(size_t len) noexcept {
+    // the string contents are NUL-terminated.
+    return round_to_word(sizeof(data) + len + 1);
+}
+
+size_t friar::heap::array_size(size_t len) noexcept {
+    return round_to_word(sizeof(data) + len * sizeof(auint));
+}
+
+size_t friar::heap::sexp_size(size_t members) noexcept {
+    return round_to_word(sizeof(sexp) + members * sizeof(auint));
+}
+
+size_t friar::heap::closure_size(size_t fields) noexcept {
+    return round_to_word(sizeof(data) + fields * sizeof(auint));
+}
+
+void Allocator::shutdown() noexcept {
+    if (runtime_initialized_) {
+        __shutdown();
+        runtime_initialized_ = false;
+        next_ = nullptr;
+    }
+}
+
+template<class F>
+void *Allocator::allocate(ObjectKind kind, size_t size, uint32_t site, F &&alloc) noexcept {
+    if (!runtime_initialized_) [[unlikely]] {
+        __init();
+        runtime_initialized_ = true;
+    }
+
+    bool timed = timing_ == Timing::Exact || listener_
+        || (timing_ == Timing::Sampled && sample_from_ && next_ + size > sample_from_);
+    Clock::time_point start;
+
+    if (timed) {
+        start = Clock::now();
+    }
+
+    auto *obj = static_cast<std::byte *>(alloc());
+    bool collected = next_ != nullptr && obj != next_;
+
+    if (collected) {
+        // the heap ended before `next_ + size`, and the next collection happens at its end.
+        sample_from_ = next_;
+    }
+
+    next_ = obj + size;
+
+    ++stats_.objects;
+    stats_.bytes += size;
+
+    if (site_profile_) {
+        site_profile_->record(site, kind, size);
+    }
+
+    if (collected) {
+        ++stats_.collections;
+        stats_.bytes_since_collection = size;
+
+        if (timed) {
+            auto end = Clock::now();
+            auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+            stats_.gc_time += pause;
+            stats_.max_gc_pause = std::max(stats_.max_gc_pause, pause);
+            ++stats_.timed_collections;
+
+            if (listener_) {
+                listener_(start, end);
+            }
+        }
+    } else {
+        stats_.bytes_since_collection += size;
+    }
+
+    stats_.max_bytes_between_collections =
+        std::max(stats_.max_bytes_between_collections, stats_.bytes_since_collection);
+
+    return get_object_content_ptr(obj);
+}
+
+void *Allocator::alloc_string(size_t len, uint32_t site) noexcept {
+    return allocate(ObjectKind::String, string_size(len), site, [&] {
+        return ::alloc_string(len);
+    });
+}
+
+void *Allocator::alloc_array(size_t len, uint32_t site) noexcept {
+    return allocate(ObjectKind::Array, array_size(len), site, [&] { return ::alloc_array(len); });
+}
+
+void *Allocator::alloc_sexp(size_t members, uint32_t site) noexcept {
+    return allocate(ObjectKind::Sexp, sexp_size(members), site, [&] {
+        return ::alloc_sexp(members);
+    });
+}
+
+void *Allocator::alloc_closure(size_t fields, uint32_t site) noexcept {
+    return allocate(ObjectKind::Closure, closure_size(fields), site, [&] {
+        return ::alloc_closure(fields);
+    });
+}
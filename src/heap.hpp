@@ -0,0 +1,181 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "bytecode.hpp"
+
+namespace friar::heap {
+
+/// Heap allocation statistics.
+struct Stats {
+    /// The number of allocated objects.
+    uint64_t objects = 0;
+
+    /// The total size of the allocated objects in bytes, including their headers.
+    uint64_t bytes = 0;
+
+    /// The number of detected garbage collections.
+    ///
+    /// The runtime does not report collections, so they are inferred from breaks in its bump
+    /// allocation: if a new object does not immediately follow the previous one, the heap must have
+    /// been compacted (or moved) in between.
+    uint64_t collections = 0;
+
+    /// The total size of the objects allocated since the last detected collection.
+    uint64_t bytes_since_collection = 0;
+
+    /// The largest value `bytes_since_collection` has reached.
+    ///
+    /// Everything allocated between two collections has to fit in the heap at once, so this is a
+    /// lower bound on the heap size the program needed.
+    uint64_t max_bytes_between_collections = 0;
+
+    /// The total duration of the allocations that triggered a collection.
+    ///
+    /// Only measured while collection timing is enabled, and only for `timed_collections` of them.
+    std::chrono::nanoseconds gc_time{0};
+
+    /// The number of collections whose duration is included in `gc_time`.
+    uint64_t timed_collections = 0;
+
+    /// The longest duration of an allocation that triggered a collection.
+    std::chrono::nanoseconds max_gc_pause{0};
+};
+
+/// The kind of a heap object.
+enum class ObjectKind : uint8_t {
+    String,
+    Array,
+    Sexp,
+    Closure,
+};
+
+/// Returns a lowercase name of `kind`.
+std::string_view kind_name(ObjectKind kind) noexcept;
+
+/// Allocation counts for each allocating instruction.
+class SiteProfile {
+public:
+    void record(uint32_t site, ObjectKind kind, uint64_t bytes) {
+        auto &entry = sites_[site];
+        entry.kind = kind;
+        ++entry.objects;
+        entry.bytes += bytes;
+    }
+
+    /// Writes the profile as a table sorted by the allocated size in descending order.
+    void write(const bytecode::Module &mod, std::ostream &s) const;
+
+private:
+    struct Site {
+        ObjectKind kind = ObjectKind::String;
+        uint64_t objects = 0;
+        uint64_t bytes = 0;
+    };
+
+    std::unordered_map<uint32_t, Site> sites_;
+};
+
+/// The size of a string object of `len` bytes on the heap.
+size_t string_size(size_t len) noexcept;
+
+/// The size of an array object with `len` elements on the heap.
+size_t array_size(size_t len) noexcept;
+
+/// The size of an S-expression object with `members` members on the heap.
+size_t sexp_size(size_t members) noexcept;
+
+/// The size of a closure object with `fields` fields (including the code pointer) on the heap.
+size_t closure_size(size_t fields) noexcept;
+
+/// Allocates objects on the garbage-collected heap managed by the Lama runtime.
+///
+/// All allocation methods return a pointer to the object's contents rather than its header. `site`
+/// is the address of the allocating instruction.
+///
+/// The runtime's heap is initialized by the first allocation, so programs that never allocate do
+/// not pay for it. The GC root range must be set up before then.
+class Allocator {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// How collections are timed.
+    enum class Timing : uint8_t {
+        /// Collections are not timed.
+        Off,
+
+        /// Only the allocations that may trigger a collection are timed.
+        ///
+        /// A collection happens when the bump allocation reaches the end of the heap, which lies
+        /// past the address where the previous collection was triggered, so only the allocations
+        /// reaching that far are timed. The first collection is not timed, and neither are
+        /// collections after the runtime moves the heap to lower addresses.
+        Sampled,
+
+        /// Every allocation is timed.
+        Exact,
+    };
+
+    /// A callback invoked after a garbage collection is detected.
+    ///
+    /// Receives the time span of the allocation that triggered the collection.
+    using CollectionListener = std::function<void(Clock::time_point start, Clock::time_point end)>;
+
+    void *alloc_string(size_t len, uint32_t site) noexcept;
+    void *alloc_array(size_t len, uint32_t site) noexcept;
+    void *alloc_sexp(size_t members, uint32_t site) noexcept;
+    void *alloc_closure(size_t fields, uint32_t site) noexcept;
+
+    const Stats &stats() const noexcept {
+        return stats_;
+    }
+
+    /// Shuts the runtime's heap down if it has been initialized, freeing every object.
+    void shutdown() noexcept;
+
+    /// Sets the callback invoked after each detected garbage collection.
+    ///
+    /// While a listener is set, collections are timed as if by `Timing::Exact`.
+    void set_collection_listener(CollectionListener listener) {
+        listener_ = std::move(listener);
+    }
+
+    /// Sets how `Stats::gc_time` and `Stats::max_gc_pause` are measured.
+    ///
+    /// Collections are not announced in advance, so the allocations that may trigger one are timed.
+    void set_collection_timing(Timing timing) noexcept {
+        timing_ = timing;
+    }
+
+    /// Sets the profile that receives every allocation, or disables profiling if null.
+    void set_site_profile(SiteProfile *profile) noexcept {
+        site_profile_ = profile;
+    }
+
+private:
+    template<class F>
+    void *allocate(ObjectKind kind, size_t size, uint32_t site, F &&alloc) noexcept;
+
+    Stats stats_;
+
+    // the address where the next object is allocated unless the heap is collected.
+    std::byte *next_ = nullptr;
+
+    bool runtime_initialized_ = false;
+
+    CollectionListener listener_;
+    Timing timing_ = Timing::Off;
+
+    // the address where the last collection was triggered, if any (for `Timing::Sampled`).
+    std::byte *sample_from_ = nullptr;
+    SiteProfile *site_profile_ = nullptr;
+};
+
+} // namespace friar::heap
@@ -0,0 +1,251 @@
+#include "heap_dump.hpp"
+
+#include <atomic>
+#include <bit>
+#include <csignal>
+#include <deque>
+#include <format>
+#include <map>
+#include <print>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "heap.hpp"
+#include "runtime.hpp"
+
+using namespace friar;
+using namespace friar::heap_dump;
+
+namespace {
+
+std::atomic<bool> signal_requested = false;
+
+void handle_dump_signal(int) {
+    signal_requested.store(true, std::memory_order_relaxed);
+}
+
+struct Usage {
+    uint64_t objects = 0;
+    uint64_t bytes = 0;
+
+    void add(uint64_t size) noexcept {
+        ++objects;
+        bytes += size;
+    }
+};
+
+// where an object was first reached from.
+struct Retainer {
+    // the retaining object, or `nullptr` if retained by a root.
+    const void *obj = nullptr;
+
+    // the field index in the retaining object, or the root index.
+    size_t idx = 0;
+};
+
+std::string length_bucket(uint64_t len) {
+    if (len == 0) {
+        return "0";
+    }
+
+    auto lo = std::bit_floor(len);
+    auto hi = lo * 2 - 1;
+
+    return lo == hi ? std::format("{}", lo) : std::format("{}-{}", lo, hi);
+}
+
+void print_usage(std::ostream &s, std::string_view name, const Usage &usage) {
+    std::println(s, "  {:<24} {:>12} {:>14}", name, usage.objects, usage.bytes);
+}
+
+} // namespace
+
+void friar::heap_dump::install_signal_handler(int signo) {
+    struct sigaction action = {};
+    action.sa_handler = handle_dump_signal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(signo, &action, nullptr);
+}
+
+bool friar::heap_dump::take_signal_request() noexcept {
+    return signal_requested.load(std::memory_order_relaxed)
+        && signal_requested.exchange(false, std::memory_order_relaxed);
+}
+
+Dumper::Dumper(std::ostream &s, bool write_graph) : s_(s), write_graph_(write_graph) {}
+
+void Dumper::dump(
+    std::string_view reason,
+    const void *roots_begin,
+    const void *roots_end,
+    size_t global_count,
+    uint64_t allocations
+) {
+    const auto *roots = static_cast<const auint *>(roots_begin);
+    auto root_count = static_cast<size_t>(static_cast<const auint *>(roots_end) - roots);
+
+    std::unordered_map<const void *, Retainer> retainers;
+    std::deque<const void *> queue;
+
+    auto visit = [&](auint repr, Retainer retainer) {
+        if (UNBOXED(repr)) {
+            return;
+        }
+
+        // NOLINTNEXTLINE(performance-no-int-to-ptr)
+        const auto *obj = reinterpret_cast<const void *>(repr);
+
+        if (retainers.emplace(obj, retainer).second) {
+            queue.push_back(obj);
+        }
+    };
+
+    // breadth-first, so that the recorded retainers form shortest paths from the roots.
+    for (size_t i = 0; i < root_count; ++i) {
+        visit(roots[i], Retainer{.idx = i});
+    }
+
+    Usage total;
+    std::map<std::string_view, Usage> kinds;
+    std::map<std::string_view, Usage> tags;
+    std::map<uint64_t, std::pair<std::string, Usage>> array_lengths;
+
+    struct GraphEntry {
+        const void *obj;
+        std::string_view kind;
+        uint64_t size;
+        std::string_view tag;
+    };
+
+    std::vector<GraphEntry> graph;
+
+    while (!queue.empty()) {
+        const auto *obj = queue.front();
+        queue.pop_front();
+
+        auto *contents = const_cast<void *>(obj);
+        auto *header = TO_DATA(contents);
+        auto len = static_cast<uint64_t>(LEN(header->data_header));
+        const auint *fields = nullptr;
+        std::string_view kind;
+        std::string_view tag;
+        uint64_t size = 0;
+
+        switch (get_type_header_ptr(get_obj_header_ptr(contents))) {
+        case STRING:
+            kind = "string";
+            size = heap::string_size(len);
+            break;
+
+        case ARRAY: {
+            kind = "array";
+            size = heap::array_size(len);
+            fields = reinterpret_cast<const auint *>(header->contents);
+
+            auto bucket = len == 0 ? 0 : std::bit_width(len);
+            auto &entry = array_lengths[bucket];
+
+            if (entry.first.empty()) {
+                entry.first = length_bucket(len);
+            }
+
+            entry.second.add(size);
+
+            break;
+        }
+
+        case SEXP: {
+            auto *sexp_header = TO_SEXP(contents);
+            kind = "sexp";
+            size = heap::sexp_size(len);
+            fields = reinterpret_cast<const auint *>(sexp_header->contents);
+
+            // the interpreter stores a pointer to the tag's string table entry.
+            // NOLINTNEXTLINE(performance-no-int-to-ptr)
+            tag = reinterpret_cast<const char *>(sexp_header->tag);
+            tags[tag].add(size);
+
+            break;
+        }
+
+        case CLOSURE:
+            kind = "closure";
+            size = heap::closure_size(len);
+
+            // the first field is the code address, which is stored as an integer.
+            fields = reinterpret_cast<const auint *>(header->contents);
+            break;
+        }
+
+        total.add(size);
+        kinds[kind].add(size);
+
+        for (uint64_t i = 0; fields && i < len; ++i) {
+            visit(fields[i], Retainer{.obj = obj, .idx = i});
+        }
+
+        if (write_graph_) {
+            graph.push_back(
+                GraphEntry{
+                    .obj = obj,
+                    .kind = kind,
+                    .size = size,
+                    .tag = tag,
+                }
+            );
+        }
+    }
+
+    ++dumps_;
+    std::println(s_, "# heap dump {} ({}) after {} allocations", dumps_, reason, allocations);
+    std::println(s_, "reachable: {} objects, {} bytes", total.objects, total.bytes);
+    std::println(s_, "by kind:");
+
+    for (const auto &[name, usage] : kinds) {
+        print_usage(s_, name, usage);
+    }
+
+    if (!tags.empty()) {
+        std::println(s_, "by sexp tag:");
+
+        for (const auto &[name, usage] : tags) {
+            print_usage(s_, name, usage);
+        }
+    }
+
+    if (!array_lengths.empty()) {
+        std::println(s_, "by array length:");
+
+        for (const auto &[_, entry] : array_lengths) {
+            print_usage(s_, entry.first, entry.second);
+        }
+    }
+
+    if (write_graph_) {
+        std::println(s_, "objects:");
+
+        for (const auto &entry : graph) {
+            std::print(s_, "  {} {} {}", entry.obj, entry.kind, entry.size);
+
+            if (!entry.tag.empty()) {
+                std::print(s_, " {}", entry.tag);
+            }
+
+            auto retainer = retainers.at(entry.obj);
+
+            if (retainer.obj) {
+                std::println(s_, " <- {}[{}]", retainer.obj, retainer.idx);
+            } else if (retainer.idx < global_count) {
+                std::println(s_, " <- global {}", retainer.idx);
+            } else {
+                std::println(s_, " <- stack slot {}", retainer.idx - global_count);
+            }
+        }
+    }
+
+    std::println(s_, "");
+    s_.flush();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string_view>
+
+namespace friar::heap_dump {
+
+/// Installs a handler that requests a heap dump whenever the process receives `signo`.
+void install_signal_handler(int signo);
+
+/// Returns `true` if a dump has been requested by a signal since the last call.
+bool take_signal_request() noexcept;
+
+/// Writes censuses of the objects reachable from the GC roots.
+class Dumper {
+public:
+    /// If `write_graph` is set, each dump also lists every reachable object along with the object
+    /// (or root) it was first reached from, which gives a retainer path for any object.
+    Dumper(std::ostream &s, bool write_graph);
+
+    /// If set, a dump is written once this many objects have been allocated.
+    std::optional<uint64_t> at_allocation;
+
+    /// Walks the objects reachable from the roots in `[roots_begin, roots_end)` and writes a dump.
+    ///
+    /// The first `global_count` roots are the module's globals.
+    void dump(
+        std::string_view reason,
+        const void *roots_begin,
+        const void *roots_end,
+        size_t global_count,
+        uint64_t allocations
+    );
+
+private:
+    std::ostream &s_;
+    bool write_graph_;
+    uint32_t dumps_ = 0;
+};
+
+} // namespace friar::heap_dump
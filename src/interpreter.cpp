@@ -3,20 +3,28 @@
 #include "config.hpp"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <cctype>
+#include <charconv>
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <format>
 #include <iostream>
+#include <optional>
 #include <ostream>
 #include <sstream>
 #include <stdexcept>
+#include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "heap_dump.hpp"
 #include "runtime.hpp"
+#include "stack.hpp"
+#include "tuple_return.hpp"
 #include "util.hpp"
 #include "verifier.hpp"
 
@@ -30,7 +38,11 @@ extern "C" void *__gc_stack_bottom; // NOLINT(bugprone-reserved-identifier)
 
 namespace {
 
-constexpr uint32_t max_stack_size = 0x7fff'ffffU;
+// the smallest stack reservation (in values) accepted if the system refuses to reserve the maximum.
+constexpr uint32_t min_stack_reservation = 1U << 20;
+
+// the call stack's capacity is never shrunk below this many frames.
+constexpr size_t min_frames_capacity = 1U << 14;
 
 class UniqueRunnerGuard {
 public:
@@ -50,15 +62,17 @@ private:
 
 std::atomic<bool> UniqueRunnerGuard::running = false;
 
-class GcGuard {
+template<class F>
+class ScopeExit {
 public:
-    GcGuard() noexcept {
-        __init();
-    }
+    explicit ScopeExit(F f) : f_(std::move(f)) {}
 
-    ~GcGuard() noexcept {
-        __shutdown();
+    ~ScopeExit() noexcept {
+        f_();
     }
+
+private:
+    F f_;
 };
 
 constexpr auint unboxed_contents = static_cast<auint>(-1) >> 1;
@@ -321,23 +335,103 @@ void Value::stringify_to(std::ostream &s) const noexcept {
     }
 }
 
+// reads everything left in `s`.
+std::string read_rest(std::istream &s) {
+    constexpr size_t chunk_size = 64 * 1024;
+
+    std::string result;
+    size_t len = 0;
+
+    while (s) {
+        result.resize(len + chunk_size);
+        s.read(result.data() + len, chunk_size);
+        len += static_cast<size_t>(s.gcount());
+    }
+
+    result.resize(len);
+
+    return result;
+}
+
+// parses whitespace-separated integers from `s`, appending them to `out`.
+// returns the first token that is not an integer, if any.
+std::optional<std::string_view> parse_ints(std::string_view s, std::vector<aint> &out) {
+    auto is_space = [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; };
+    const char *p = s.data();
+    const char *end = s.data() + s.size();
+
+    while (true) {
+        p = std::find_if_not(p, end, is_space);
+
+        if (p == end) {
+            return std::nullopt;
+        }
+
+        const char *token_end = std::find_if(p, end, is_space);
+        const char *num_start = *p == '+' ? p + 1 : p;
+
+        // from_chars accepts a minus sign but not a plus, so "+-5" must be rejected explicitly.
+        if (num_start == token_end || (num_start != p && *num_start == '-')) {
+            return std::string_view(p, token_end);
+        }
+
+        aint v = 0;
+        auto [ptr, ec] = std::from_chars(num_start, token_end, v);
+
+        if (ec != std::errc() || ptr != token_end) {
+            return std::string_view(p, token_end);
+        }
+
+        out.push_back(v);
+        p = token_end;
+    }
+}
+
 } // namespace
 
 Interpreter::Interpreter(
-    bytecode::Module &mod,
-#ifndef DYNAMIC_VERIFICATION
-    const verifier::ModuleInfo &info,
-#endif
+    const program::Program &program,
     std::istream &input,
-    std::ostream &output
+    std::ostream &output,
+    Opts opts
 )
-    : mod_(mod),
+    : mod_(program.mod()),
 #ifndef DYNAMIC_VERIFICATION
-      info_(info),
+      info_(program.info()),
 #endif
-      input_(input), output_(output) {
+      input_(input), output_(output), opts_(opts) {
+#ifdef COVERAGE
+    coverage_.resize(mod_.bytecode.size());
+#endif
+
+    allocator_.set_site_profile(opts_.alloc_sites);
+
+    auto timing = opts_.time_collections ? heap::Allocator::Timing::Exact
+                                         : heap::Allocator::Timing::Off;
+
+#ifdef RUNTIME_METRICS
+    // the metrics are always on, so they only sample collections to keep allocations cheap.
+    if (timing == heap::Allocator::Timing::Off && opts_.metrics) {
+        timing = heap::Allocator::Timing::Sampled;
+    }
+#endif
+
+    allocator_.set_collection_timing(timing);
+
+    if (auto *trace = opts_.trace) {
+        allocator_.set_collection_listener([trace](auto start, auto end) {
+            trace->add_span("garbage collection", "gc", start, end);
+        });
+    }
 }
 
+#ifdef CALL_GRAPH_PROFILER
+void Interpreter::write_profile(std::ostream &s) {
+    profiler_.finish(allocator_.stats().bytes);
+    profiler_.write_callgrind(mod_, s);
+}
+#endif
+
 #ifdef DYNAMIC_VERIFICATION
 template<class T>
 using DynamicExpected = std::expected<T, Interpreter::Error>;
@@ -351,11 +445,45 @@ std::expected<void, Interpreter::Error> Interpreter::run() {
     UniqueRunnerGuard _unique_guard;
 
     std::vector<Frame> frames;
-    std::vector<auint> stack;
     std::span<const Instr> bc = mod_.bytecode;
 
+    auto stack_r = stack::Stack<auint>::create(
+        opts_.max_stack_size, std::min<size_t>(opts_.max_stack_size, min_stack_reservation)
+    );
+
+    if (!stack_r) {
+        return std::unexpected(Error{
+            .msg = std::format("could not reserve the value stack: {}", stack_r.error().message()),
+        });
+    }
+
+    auto &stack = *stack_r;
+    size_t call_depth_high_water = 0;
+
+    // `stack.size()` as of the last time the stack was shrunk.
+    size_t stack_high_water = 0;
+
+    // record the high-water marks however the run ends.
+    ScopeExit _record_memory_stats([&] {
+        memory_stats_ = MemoryStats{
+            .stack_high_water = std::max(stack_high_water, stack.size()),
+            .max_call_depth = call_depth_high_water,
+            .value_size = sizeof(auint),
+            .frame_size = sizeof(Frame),
+        };
+    });
+
     // globals + 2 dummy `main` arguments.
-    stack.resize(mod_.global_count + 2, BOX(0));
+    if (static_cast<uint64_t>(mod_.global_count) + 2 > stack.max_size()) {
+        return std::unexpected(Error{
+            .msg = std::format("too many globals to fit on the stack: {}", mod_.global_count),
+        });
+    }
+
+    stack.resize(
+        std::max<size_t>(mod_.global_count + 2, std::min(opts_.stack_prealloc, stack.max_size())),
+        BOX(0)
+    );
 
     // per-frame registers.
     uint32_t pc = -1;
@@ -364,12 +492,23 @@ std::expected<void, Interpreter::Error> Interpreter::run() {
 
 #ifdef DYNAMIC_VERIFICATION
     uint32_t locals = 0;
+#else
+    // the elements of the tuple returned by a scalar-replaced procedure (see
+    // `tuple_return::scalar_replace`), written by `VALUES` and read by `ELEM` at the call site.
+    //
+    // the collector does not scan this buffer, so nothing may allocate between the two: a
+    // collection in between would leave the values dangling. `tuple_return` guarantees this by
+    // only accepting `LINE`, `JMP`, and `END` after the allocation it replaces, and `DUP`, `CONST`,
+    // `ELEM`, stores, `DROP`, `ARRAY`, `TAG`, and `CJMPz` at the call site, none of which
+    // allocates.
+    std::array<Value, tuple_return::max_values> returned_values;
 #endif
 
-    // initialize the GC (use a virtual stack).
+    // set up the GC roots (use a virtual stack). the heap itself is initialized on the first
+    // allocation.
     __gc_stack_top = static_cast<void *>(stack.data());
     __gc_stack_bottom = static_cast<void *>(stack.data() + base);
-    GcGuard _gc_guard;
+    ScopeExit _shutdown_heap([this] { allocator_.shutdown(); });
 
     auto backtrace = [&] {
         Backtrace result;
@@ -389,7 +528,10 @@ std::expected<void, Interpreter::Error> Interpreter::run() {
         return result;
     };
 
-    auto make_error = [&]<class... Args>(std::format_string<Args...> s, Args &&...args) {
+    // errors end the run, so keep their construction out of the dispatch loop's hot code.
+    auto make_error = [&]<class... Args> [[gnu::cold, gnu::noinline]] (
+        std::format_string<Args...> s, Args &&...args
+    ) {
         return Error{
             .backtrace = backtrace(),
             .msg = std::format(s, std::forward<Args>(args)...),
@@ -477,7 +619,7 @@ std::expected<void, Interpreter::Error> Interpreter::run() {
 #ifdef DYNAMIC_VERIFICATION
         auto new_size = stack_size() + 1;
 
-        if (new_size > max_stack_size) [[unlikely]] {
+        if (new_size > stack.max_size()) [[unlikely]] {
             return std::unexpected(make_error("stack overflow"));
         }
 
@@ -638,6 +780,92 @@ std::expected<void, Interpreter::Error> Interpreter::run() {
     auto check_begin = [](uint32_t l) {};
 #endif
 
+    // runs `f`, recording it on the timeline if it blocks for long enough.
+    auto trace_io = [&](std::string_view name, auto &&f) {
+        if (!opts_.trace) {
+            f();
+
+            return;
+        }
+
+        auto start = trace_events::Clock::now();
+        f();
+        auto end = trace_events::Clock::now();
+
+        if (end - start >= opts_.trace->io_threshold) {
+            opts_.trace->add_span(std::string(name), "io", start, end);
+        }
+    };
+
+    auto dump_heap = [&](std::string_view reason) {
+        opts_.heap_dump->dump(
+            reason,
+            __gc_stack_top,
+            __gc_stack_bottom,
+            mod_.global_count,
+            allocator_.stats().objects
+        );
+    };
+
+    // writes a heap dump if one is due. called before allocations, when all live values are rooted.
+    auto check_heap_dump = [&] {
+        if (!opts_.heap_dump) {
+            return;
+        }
+
+        if (heap_dump::take_signal_request()) {
+            dump_heap("signal");
+        } else if (opts_.heap_dump->at_allocation == allocator_.stats().objects) {
+            dump_heap("allocation count");
+        }
+    };
+
+    ScopeExit _dump_heap_at_exit([&] {
+        if (opts_.heap_dump) {
+            dump_heap("exit");
+        }
+    });
+
+    bool trace_calls = opts_.trace && opts_.trace->call_threshold;
+    std::vector<trace_events::Clock::time_point> call_starts;
+
+#ifdef RUNTIME_METRICS
+    // instructions are counted in periods rather than one by one to keep the dispatch loop cheap.
+    constexpr uint32_t metrics_period = 4096;
+    uint64_t instrs_published = 0;
+    uint32_t metrics_countdown = metrics_period;
+    uint64_t calls = 0;
+
+    auto publish_metrics = [&] {
+        auto *m = opts_.metrics;
+
+        if (!m) {
+            return;
+        }
+
+        constexpr auto relaxed = std::memory_order_relaxed;
+        const auto &heap = allocator_.stats();
+
+        m->instrs.store(instrs_published + (metrics_period - metrics_countdown), relaxed);
+        m->calls.store(calls, relaxed);
+        m->alloc_objects.store(heap.objects, relaxed);
+        m->alloc_bytes.store(heap.bytes, relaxed);
+        m->heap_bytes_since_gc.store(heap.bytes_since_collection, relaxed);
+        m->collections.store(heap.collections, relaxed);
+        m->gc_pause_ns.store(heap.gc_time.count(), relaxed);
+        m->timed_collections.store(heap.timed_collections, relaxed);
+        m->stack_high_water.store(
+            std::max(stack_high_water, stack.size()) * sizeof(auint), relaxed
+        );
+        m->call_depth.store(frames.size(), relaxed);
+        m->pc.store(pc, relaxed);
+        m->proc_addr.store(frames.empty() ? 0 : frames.back().proc_addr, relaxed);
+    };
+
+    // publish the final values however the run ends.
+    ScopeExit _publish_metrics(publish_metrics);
+#endif
+
     // the address to call.
     uint32_t call_target = 0;
     bool call_closure = false;
@@ -647,6 +875,12 @@ std::expected<void, Interpreter::Error> Interpreter::run() {
 #endif
 
 enter_frame:
+    if (frames.size() >= opts_.max_call_depth) [[unlikely]] {
+        return std::unexpected(
+            make_error("exceeded the call depth limit of {}", opts_.max_call_depth)
+        );
+    }
+
     frames.push_back(
         Frame{
             .proc_addr = call_target,
@@ -661,6 +895,19 @@ enter_frame:
             .is_closure = call_closure,
         }
     );
+    call_depth_high_water = std::max(call_depth_high_water, frames.size());
+
+#ifdef CALL_GRAPH_PROFILER
+    profiler_.enter(call_target, allocator_.stats().bytes);
+#endif
+
+#ifdef RUNTIME_METRICS
+    ++calls;
+#endif
+
+    if (trace_calls) {
+        call_starts.push_back(trace_events::Clock::now());
+    }
 
     pc = call_target;
 
@@ -678,45 +925,16 @@ enter_frame:
 #endif
 
     while (true) {
-#if INTERPRETER_TRACE
-        std::print(std::cerr, "[{:#x}] op = {:#02x} ", pc, uint8_t(bc[pc]));
-
-#if INTERPRETER_TRACE >= 2
-        std::print(std::cerr, "stack = [");
-
-        for (size_t i = 0; i < stack.size(); ++i) {
-            if (__gc_stack_bottom == stack.data() + i) {
-                if (i == 0) {
-                    std::print(std::cerr, "| ");
-                } else {
-                    std::print(std::cerr, " | ");
-                }
-            } else if (i > 0) {
-                std::print(std::cerr, ", ");
-            }
-
-            std::print(std::cerr, "{:#x}", stack[i]);
-            std::print(
-                std::cerr,
-                " ({} `{}`)",
-                Value::from_repr(stack[i]).type_to_string(),
-                Value::from_repr(stack[i]).stringify()
-            );
-        }
-
-        std::print(std::cerr, "]");
-#else
-        std::print(
-            std::cerr,
-            "stack height = {} ({} max, {} allocated)",
-            static_cast<auint *>(__gc_stack_bottom) - static_cast<auint *>(__gc_stack_top),
-            stack.size(),
-            stack.capacity()
-        );
+#ifdef CALL_GRAPH_PROFILER
+        profiler_.dispatch();
 #endif
 
-        std::println(std::cerr, "");
-
+#ifdef RUNTIME_METRICS
+        if (--metrics_countdown == 0) [[unlikely]] {
+            instrs_published += metrics_period;
+            metrics_countdown = metrics_period;
+            publish_metrics();
+        }
 #endif
 
 #ifdef DYNAMIC_VERIFICATION
@@ -756,6 +974,30 @@ enter_frame:
         }
 #endif
 
+#if INTERPRETER_TRACE
+        if (opts_.exec_trace) {
+            auto *bottom = static_cast<auint *>(__gc_stack_bottom);
+            auto height = bottom - static_cast<auint *>(__gc_stack_top);
+            uint64_t tos = 0;
+
+#if INTERPRETER_TRACE >= 2
+            if (height > 0) {
+                // sign-extended so that the decoder can unbox negative integers.
+                tos = static_cast<uint64_t>(static_cast<int64_t>(static_cast<aint>(bottom[-1])));
+            }
+#endif
+
+            opts_.exec_trace->record(pc, bc[pc], height, tos);
+        }
+#endif
+
+#ifdef COVERAGE
+        coverage_[pc] = 1;
+#endif
+
+        // the address of the current instruction (`pc` moves past its immediates).
+        uint32_t instr_addr = pc;
+
         switch (bc[pc++]) {
         case Instr::Add: {
             PROPAGATE_DYNEXP(v1, top_nth(1));
@@ -1026,10 +1268,11 @@ enter_frame:
         case Instr::String: {
             PROPAGATE_DYNEXP(s, read_u32());
             PROPAGATE_DYNEXP(sv, check_strtab(s));
-            auto *v = get_object_content_ptr(alloc_string(sv.length()));
+            check_heap_dump();
+            auto *v = allocator_.alloc_string(sv.length(), instr_addr);
             PROPAGATE_DYNEXP_VOID(push(Value::from_ptr(v)));
-            // NOLINTNEXTLINE(bugprone-suspicious-stringview-data-usage)
-            strcpy(TO_DATA(v)->contents, sv.data());
+            // strtab entries are NUL-terminated.
+            std::memcpy(TO_DATA(v)->contents, sv.data(), sv.length() + 1);
 
             break;
         }
@@ -1038,7 +1281,8 @@ enter_frame:
             PROPAGATE_DYNEXP(s, read_u32());
             PROPAGATE_DYNEXP(n, read_u32());
             PROPAGATE_DYNEXP(tag, check_strtab(s));
-            auto *v = get_object_content_ptr(alloc_sexp(n));
+            check_heap_dump();
+            auto *v = allocator_.alloc_sexp(n, instr_addr);
             TO_SEXP(v)->tag = reinterpret_cast<auint>(tag.data());
 
             if (n > verifier::max_member_count) {
@@ -1137,6 +1381,27 @@ enter_frame:
         case Instr::Ret: {
             PROPAGATE_DYNEXP_T(Value, v, top_nth(0));
             auto &frame = frames.back();
+
+#ifdef CALL_GRAPH_PROFILER
+            profiler_.leave(allocator_.stats().bytes);
+#endif
+
+            if (trace_calls) {
+                auto start = call_starts.back();
+                auto end = trace_events::Clock::now();
+                call_starts.pop_back();
+
+                if (end - start >= *opts_.trace->call_threshold) {
+                    auto name = mod_.symbol_at(frame.proc_addr);
+                    opts_.trace->add_span(
+                        name ? std::string(*name) : std::format("<anon {:#x}>", frame.proc_addr),
+                        "call",
+                        start,
+                        end
+                    );
+                }
+            }
+
             __gc_stack_bottom = static_cast<void *>(
                 static_cast<auint *>(__gc_stack_top) + base - args - (frame.is_closure ? 1 : 0)
             );
@@ -1376,32 +1641,51 @@ enter_frame:
             params &= 0xffff;
 
             base = stack_size();
+
+#ifndef DYNAMIC_VERIFICATION
+            if ((locals & verifier::shares_captures_flag) != 0) [[unlikely]] {
+                // the closure only refers to the closure that owns its captures, which stands in
+                // for it in the frame.
+                locals &= ~verifier::shares_captures_flag;
+                auto &closure = stack.data()[base - params - 1];
+                closure = Value::from_repr(closure).field(1).get().to_repr();
+            }
+#endif
             auto new_size = static_cast<uint64_t>(base) + locals + proc_stack_size;
 
-            if (new_size > max_stack_size) [[unlikely]] {
+            if (new_size > stack.max_size()) [[unlikely]] {
                 return std::unexpected(make_error("stack overflow"));
             }
 
             if (stack.size() < new_size) {
                 stack.resize(new_size, BOX(0));
+            } else if (stack.size() / 4 > new_size + verifier::max_stack_size
+                       && stack.size() / 2 > opts_.stack_prealloc) [[unlikely]] {
+                // a deep recursion has unwound: return the unused tail to the system. A caller's
+                // operands never extend more than `max_stack_size` past the current frame's base,
+                // so that much is kept. Keeping twice what is needed means that the memory is only
+                // released again once usage halves, rather than on every return.
+                stack_high_water = std::max(stack_high_water, stack.size());
+                stack.shrink(std::max<size_t>(
+                    2 * (new_size + verifier::max_stack_size), opts_.stack_prealloc
+                ));
             }
 
+            if (frames.capacity() / 4 > std::max(frames.size(), min_frames_capacity)) [[unlikely]] {
+                std::vector<Frame> shrunk;
+                shrunk.reserve(2 * std::max(frames.size(), min_frames_capacity));
+                shrunk.assign(frames.begin(), frames.end());
+                frames = std::move(shrunk);
+            }
+
+            // the locals are GC roots: clear whatever a previous frame left there so that stale
+            // pointers do not keep dead objects alive (and make every collection mark them).
+            std::fill_n(stack.data() + base, locals, BOX(0));
+
             args = params;
             __gc_stack_top = static_cast<void *>(stack.data());
             __gc_stack_bottom = static_cast<void *>(stack.data() + base + locals);
 
-#if INTERPRETER_TRACE
-            std::println(
-                std::cerr,
-                "calling {:#x} ({}{} args, {} locals, {} values pre-allocated)",
-                call_target,
-                args,
-                frames.back().is_closure ? " + 1" : "",
-                locals,
-                proc_stack_size
-            );
-#endif
-
             break;
         }
 
@@ -1409,10 +1693,81 @@ enter_frame:
             PROPAGATE_DYNEXP(l, read_u32());
             PROPAGATE_DYNEXP_VOID(check_begin(l));
             PROPAGATE_DYNEXP(n, read_u32());
-            auto *closure = get_object_content_ptr(alloc_closure(n + 1));
+
+#ifdef DYNAMIC_VERIFICATION
+            auto fields = n + 1;
+#else
+            const verifier::ModuleInfo::ClosureSite *site = nullptr;
+
+            if ((n & verifier::closure_site_flag) != 0) {
+                site = &info_.closure_sites[(n & ~verifier::closure_site_flag) >> 16];
+                n &= 0xffff;
+            }
+
+            // a closure sharing the captures only refers to the closure that owns them.
+            auto fields =
+                site && site->kind == verifier::ModuleInfo::ClosureSite::Share ? 2 : n + 1;
+#endif
+
+            check_heap_dump();
+            auto *closure = allocator_.alloc_closure(fields, instr_addr);
             PROPAGATE_DYNEXP_VOID(push(Value::from_ptr(closure)));
             get_object_field(closure, 0) = Value::from_int(static_cast<auint>(l));
 
+#ifndef DYNAMIC_VERIFICATION
+            if (site) {
+                // the enclosing closure (which the allocation may have moved) or, if it shares the
+                // captures, the closure that owns them.
+                auto parent =
+                    Value::from_repr(static_cast<auint *>(__gc_stack_top)[base - args - 1]);
+
+                switch (site->kind) {
+                case verifier::ModuleInfo::ClosureSite::Share:
+                    get_object_field(closure, 1) = parent;
+                    break;
+
+                case verifier::ModuleInfo::ClosureSite::Copy:
+                    std::memcpy(
+                        static_cast<auint *>(closure) + 1,
+                        static_cast<const auint *>(parent.get_ptr()) + 1,
+                        n * sizeof(auint)
+                    );
+                    break;
+
+                case verifier::ModuleInfo::ClosureSite::Table:
+                    for (size_t i = 0; i < n; ++i) {
+                        const auto &var = info_.captured_vars[site->first + i];
+                        auto field = get_object_field(closure, i + 1);
+
+                        switch (var.kind) {
+                        case verifier::ModuleInfo::CapturedVar::Global:
+                            field.set(global(var.idx));
+                            break;
+
+                        case verifier::ModuleInfo::CapturedVar::Local:
+                            field.set(local(var.idx));
+                            break;
+
+                        case verifier::ModuleInfo::CapturedVar::Param:
+                            field.set(arg(var.idx));
+                            break;
+
+                        case verifier::ModuleInfo::CapturedVar::Capture:
+                            field.set(capture(var.idx));
+                            break;
+                        }
+                    }
+
+                    break;
+                }
+
+                // skip the variable descriptors.
+                pc += n * (1 + sizeof(uint32_t));
+
+                break;
+            }
+#endif
+
 #ifdef DYNAMIC_VERIFICATION
             if (n > verifier::max_captures) {
                 return std::unexpected(make_error(
@@ -1656,13 +2011,75 @@ enter_frame:
 
         case Instr::CallLread: {
             aint v = 0;
-            output_ << " > " << std::flush;
-            input_ >> v;
+            trace_io("Lread", [&] {
+                output_ << " > " << std::flush;
+                input_ >> v;
+            });
             PROPAGATE_DYNEXP_VOID(push(Value::from_int(v)));
 
             break;
         }
 
+        case Instr::CallLreadAll: {
+            std::string text;
+            trace_io("Lreadall", [&] { text = read_rest(input_); });
+            std::vector<aint> values;
+
+            if (auto bad = parse_ints(text, values)) {
+                return std::unexpected(make_error("cannot read {:?} as an integer", *bad));
+            }
+
+            if (values.size() > verifier::max_elem_count) [[unlikely]] {
+                return std::unexpected(make_error(
+                    "too many array elements: expected at most {}, got {}",
+                    verifier::max_elem_count,
+                    values.size()
+                ));
+            }
+
+            check_heap_dump();
+            auto *v = allocator_.alloc_array(values.size(), instr_addr);
+            auto *elems = static_cast<auint *>(v);
+
+            for (size_t i = 0; i < values.size(); ++i) {
+                elems[i] = Value::from_int(values[i]).to_repr();
+            }
+
+            PROPAGATE_DYNEXP_VOID(push(Value::from_ptr(v)));
+
+            break;
+        }
+
+        case Instr::CallLreadLine: {
+            std::string line;
+            bool ok = false;
+            trace_io("Lreadline", [&] { ok = static_cast<bool>(std::getline(input_, line)); });
+
+            if (!ok) {
+                PROPAGATE_DYNEXP_VOID(push(Value::from_int(aint{0})));
+
+                break;
+            }
+
+            check_heap_dump();
+            auto *r = allocator_.alloc_string(line.size(), instr_addr);
+            PROPAGATE_DYNEXP_VOID(push(Value::from_ptr(r)));
+            std::memcpy(TO_DATA(r)->contents, line.c_str(), line.size() + 1);
+
+            break;
+        }
+
+        case Instr::CallLreadFile: {
+            std::string text;
+            trace_io("Lreadfile", [&] { text = read_rest(input_); });
+            check_heap_dump();
+            auto *r = allocator_.alloc_string(text.size(), instr_addr);
+            PROPAGATE_DYNEXP_VOID(push(Value::from_ptr(r)));
+            std::memcpy(TO_DATA(r)->contents, text.c_str(), text.size() + 1);
+
+            break;
+        }
+
         case Instr::CallLwrite: {
             PROPAGATE_DYNEXP_T(Value, v, top_nth(0));
 
@@ -1673,7 +2090,7 @@ enter_frame:
             }
 
             PROPAGATE_DYNEXP_VOID(pop_n(1));
-            output_ << v.get_aint() << '\n';
+            trace_io("Lwrite", [&] { output_ << v.get_aint() << '\n'; });
             PROPAGATE_DYNEXP_VOID(push(Value()));
 
             break;
@@ -1698,11 +2115,11 @@ enter_frame:
         case Instr::CallLstring: {
             PROPAGATE_DYNEXP_T(Value, v, top_nth(0));
             auto s = v.stringify();
-            auto *r = get_object_content_ptr(alloc_string(s.size()));
+            check_heap_dump();
+            auto *r = allocator_.alloc_string(s.size(), instr_addr);
             PROPAGATE_DYNEXP_VOID(pop_n(1));
             PROPAGATE_DYNEXP_VOID(push(Value::from_ptr(r)));
-            // NOLINTNEXTLINE(bugprone-suspicious-stringview-data-usage)
-            strcpy(TO_DATA(r)->contents, s.data());
+            std::memcpy(TO_DATA(r)->contents, s.c_str(), s.size() + 1);
 
             break;
         }
@@ -1718,11 +2135,13 @@ enter_frame:
                 ));
             }
 
-            auto *v = get_object_content_ptr(alloc_array(n));
+            check_heap_dump();
+            auto *v = allocator_.alloc_array(n, instr_addr);
 
-            for (size_t i = 0; i < n; ++i) {
-                PROPAGATE_DYNEXP_T(Value, elem, top_nth(n - i - 1));
-                get_object_field(v, i) = elem;
+            if (n > 0) {
+                // the elements are laid out in order on top of the stack: copy them in one go.
+                PROPAGATE_DYNEXP(first, top_nth(n - 1));
+                std::memcpy(v, first.ptr(), n * sizeof(auint));
             }
 
             PROPAGATE_DYNEXP_VOID(pop_n(n));
@@ -1731,6 +2150,47 @@ enter_frame:
             break;
         }
 
+#ifndef DYNAMIC_VERIFICATION
+        // the instructions of scalar-replaced procedures, which only occur in verified bytecode.
+        case Instr::SexpValues:
+            // the callers do not check the tag.
+            read_u32();
+            [[fallthrough]];
+
+        case Instr::Values: {
+            auto n = read_u32();
+
+            for (uint32_t i = 0; i < n; ++i) {
+                returned_values[i] = top_nth(n - 1 - i);
+            }
+
+            // the callers only duplicate and drop the result.
+            pop_n(n);
+            push(Value::from_int(aint{0}));
+
+            break;
+        }
+
+        case Instr::ElemValue: {
+            Value idx = top_nth(0);
+            pop_n(2);
+            push(returned_values[idx.get_auint()]);
+
+            break;
+        }
+
+        case Instr::TagValues:
+            read_u32();
+            [[fallthrough]];
+
+        case Instr::ArrayValues:
+            // the shape is known statically, so the check always succeeds.
+            read_u32();
+            top_nth(0) = Value::from_int(aint{1});
+
+            break;
+#endif
+
         case Instr::Sti: // the STI/LDA instructions are never emitted by the Lama compiler.
         case Instr::LdaG:
         case Instr::LdaL:
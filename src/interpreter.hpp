@@ -4,15 +4,34 @@
 #include <cstdint>
 #include <expected>
 #include <istream>
+#include <limits>
 #include <optional>
 #include <ostream>
+#include <span>
 #include <string>
 #include <variant>
+#include <vector>
 
 #include "config.hpp"
 #include "bytecode.hpp"
+#include "heap.hpp"
+#include "heap_dump.hpp"
+#include "program.hpp"
+#include "trace_events.hpp"
 #include "verifier.hpp"
 
+#if INTERPRETER_TRACE
+#include "exec_trace.hpp"
+#endif
+
+#ifdef CALL_GRAPH_PROFILER
+#include "profiler.hpp"
+#endif
+
+#ifdef RUNTIME_METRICS
+#include "metrics.hpp"
+#endif
+
 namespace friar::interpreter {
 
 struct Backtrace {
@@ -33,6 +52,68 @@ struct Backtrace {
     std::vector<Frame> entries;
 };
 
+/// The default limit on the number of values on the value stack.
+constexpr size_t default_max_stack_size = 0x7fff'ffff;
+
+/// The memory high-water marks of a run.
+struct MemoryStats {
+    /// The largest number of values the value stack has held, including the globals.
+    size_t stack_high_water = 0;
+
+    /// The deepest the call stack has been, in frames.
+    size_t max_call_depth = 0;
+
+    /// The size of a value stack slot in bytes.
+    size_t value_size = 0;
+
+    /// The size of a call stack frame in bytes.
+    size_t frame_size = 0;
+};
+
+/// Interpreter options.
+struct Opts {
+    /// If set, receives timeline events: garbage collections, blocking I/O, and long calls.
+    trace_events::Recorder *trace = nullptr;
+
+    /// If set, receives the number and size of objects allocated by each instruction.
+    heap::SiteProfile *alloc_sites = nullptr;
+
+    /// Whether to measure the time spent in garbage collections (see `heap::Stats::gc_time`).
+    bool time_collections = false;
+
+    /// The maximum number of values on the value stack, including the globals.
+    ///
+    /// Only address space is reserved up front, but the reservation is made smaller if the system
+    /// refuses it.
+    size_t max_stack_size = default_max_stack_size;
+
+    /// The maximum number of nested procedure calls.
+    size_t max_call_depth = std::numeric_limits<size_t>::max();
+
+    /// The number of value stack slots to commit memory to before the run starts. The value stack
+    /// is never shrunk below this size.
+    size_t stack_prealloc = 0;
+
+    /// If set, writes heap dumps at exit and on request.
+    heap_dump::Dumper *heap_dump = nullptr;
+
+#if INTERPRETER_TRACE
+    /// If set, records every executed instruction.
+    exec_trace::Tracer *exec_trace = nullptr;
+#endif
+
+#ifdef RUNTIME_METRICS
+    /// If set, receives periodic updates of the runtime counters.
+    metrics::Counters *metrics = nullptr;
+#endif
+};
+
+/// Executes a program.
+///
+/// The interpreter only reads the program, so one program can back any number of interpreters.
+/// All mutable state of a run is owned by the interpreter or lives in `run()` itself. However, the
+/// Lama runtime's garbage collector is process-global (its heap and the root range in
+/// `__gc_stack_top`/`__gc_stack_bottom`), so at most one interpreter may run at a time.
 class Interpreter {
 public:
     struct Error {
@@ -41,16 +122,35 @@ public:
     };
 
     Interpreter(
-        bytecode::Module &mod,
-#ifndef DYNAMIC_VERIFICATION
-        const verifier::ModuleInfo &info,
-#endif
+        const program::Program &program,
         std::istream &input,
-        std::ostream &output
+        std::ostream &output,
+        Opts opts = {}
     );
 
     std::expected<void, Error> run();
 
+    const heap::Stats &heap_stats() const noexcept {
+        return allocator_.stats();
+    }
+
+    /// Returns the memory high-water marks of the last run.
+    const MemoryStats &memory_stats() const noexcept {
+        return memory_stats_;
+    }
+
+#ifdef COVERAGE
+    /// Returns the coverage bitmap: a non-zero byte for each executed instruction's address.
+    std::span<const uint8_t> coverage() const noexcept {
+        return coverage_;
+    }
+#endif
+
+#ifdef CALL_GRAPH_PROFILER
+    /// Writes the call-graph profile collected during the run in the Callgrind format.
+    void write_profile(std::ostream &s);
+#endif
+
 private:
     struct Frame {
         // the address of the procedure corresponding to the frame.
@@ -77,7 +177,7 @@ private:
         bool is_closure = false;
     };
 
-    bytecode::Module &mod_;
+    const bytecode::Module &mod_;
 
 #ifndef DYNAMIC_VERIFICATION
     const verifier::ModuleInfo &info_;
@@ -85,6 +185,17 @@ private:
 
     std::istream &input_;
     std::ostream &output_;
+    Opts opts_;
+    heap::Allocator allocator_;
+    MemoryStats memory_stats_;
+
+#ifdef CALL_GRAPH_PROFILER
+    profiler::CallGraphProfiler profiler_;
+#endif
+
+#ifdef COVERAGE
+    std::vector<uint8_t> coverage_;
+#endif
 };
 
 } // namespace friar::interpreter
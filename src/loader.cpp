@@ -1,12 +1,9 @@
 #include "loader.hpp"
 
-#include <algorithm>
 #include <bit>
 #include <cerrno>
 #include <format>
 #include <ios>
-#include <iterator>
-#include <memory>
 #include <span>
 #include <utility>
 
@@ -150,25 +147,30 @@ std::expected<void, Loader::Error> Loader::load_header() {
 }
 
 std::expected<void, Loader::Error> Loader::load_bytecode() {
-    constexpr size_t buf_size = 4096;
+    mod_.bytecode_offset = pos_;
 
-    auto pos = pos_;
-    mod_.bytecode_offset = pos;
-    auto buf = std::make_unique<Instr[]>(4096);
+    // read straight into the module, doubling the chunk size as the module turns out larger.
+    size_t size = 0;
+    size_t chunk_size = 4096;
 
     while (true) {
-        auto bytes = std::as_writable_bytes(std::span(buf.get(), buf_size));
+        mod_.bytecode.resize(size + chunk_size);
+        auto bytes = std::as_writable_bytes(std::span(mod_.bytecode).subspan(size));
+
         if (auto r = load_bytes("bytecode", bytes, true); r) {
-            auto read_instrs = std::span(buf.get(), *r);
-            std::ranges::copy(read_instrs, std::back_inserter(mod_.bytecode));
+            size += *r;
 
-            if (*r < buf_size) {
+            if (*r < bytes.size()) {
                 break;
             }
         } else {
             return std::unexpected(std::move(r).error());
         }
+
+        chunk_size = size;
     }
 
+    mod_.bytecode.resize(size);
+
     return {};
 }
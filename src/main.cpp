@@ -1,16 +1,39 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <print>
 #include <ratio>
+#include <utility>
+
+#include <unistd.h>
 
 #include "args.hpp"
+#include "async_output.hpp"
+#include "bulk_input.hpp"
 #include "config.hpp"
+#include "coverage.hpp"
 #include "disas.hpp"
+#include "exec_trace.hpp"
+#include "fd_stream.hpp"
+#include "heap.hpp"
+#include "heap_dump.hpp"
 #include "idiom.hpp"
 #include "interpreter.hpp"
 #include "loader.hpp"
+#include "metrics.hpp"
+#include "program.hpp"
+#include "relayout.hpp"
+#include "stats.hpp"
+#include "strip.hpp"
 #include "time.hpp"
+#include "trace_events.hpp"
 #include "util.hpp"
 #include "verifier.hpp"
+#include "writer.hpp"
 
 #ifdef DYNAMIC_VERIFICATION
 #include <variant>
@@ -20,6 +43,18 @@ using namespace friar;
 
 namespace {
 
+// the buffer of the program output while the program runs.
+//
+// the Lama runtime reports fatal errors (e.g., running out of memory) by calling `exit`, which
+// skips the flush after the run, so the buffer is also flushed by an `atexit` handler.
+std::streambuf *exit_output = nullptr;
+
+void flush_exit_output() {
+    if (exit_output) {
+        exit_output->pubsync();
+    }
+}
+
 int print_disas(const bytecode::Module &mod) {
     disas::disassemble(
         mod.bytecode,
@@ -33,7 +68,10 @@ int print_disas(const bytecode::Module &mod) {
 }
 
 int print_idioms(const bytecode::Module &mod, const verifier::ModuleInfo &mod_info) {
-    auto idioms = idiom::find_idioms(mod, mod_info);
+    // the immediates the verifier annotated would show up in the idioms.
+    auto plain = mod;
+    writer::clear_annotations(plain.bytecode);
+    auto idioms = idiom::find_idioms(plain, mod_info);
     auto occur_width =
         idioms.idioms.empty() ? 1 : util::compute_decimal_width(idioms.idioms.front().occurrences);
 
@@ -54,12 +92,310 @@ int print_idioms(const bytecode::Module &mod, const verifier::ModuleInfo &mod_in
     return 0;
 }
 
+int decode_trace(const std::filesystem::path &path) {
+    if (auto r = exec_trace::decode(path, std::cout); !r) {
+        std::println(std::cerr, "Could not decode the trace: {}", r.error());
+
+        return 1;
+    }
+
+    return 0;
+}
+
+bool write_module(const bytecode::Module &mod, const std::filesystem::path &path) {
+    errno = 0;
+    std::ofstream s(path, std::ios::binary);
+
+    if (s) {
+        writer::write(mod, s);
+        s.flush();
+    }
+
+    if (!s) {
+        std::println(
+            std::cerr, "Could not write {}: {}", path.c_str(), util::get_last_error().message()
+        );
+
+        return false;
+    }
+
+    return true;
+}
+
+int relayout_module(const bytecode::Module &mod, const args::Args &args) {
+    errno = 0;
+    std::ifstream profile_stream(*args.profile_file);
+
+    if (!profile_stream) {
+        std::println(
+            std::cerr,
+            "Could not open {} for reading: {}",
+            args.profile_file->c_str(),
+            util::get_last_error().message()
+        );
+
+        return 1;
+    }
+
+    auto profile = relayout::read_callgrind(profile_stream);
+
+    if (!profile) {
+        std::println(
+            std::cerr,
+            "Could not read the profile {}: {}",
+            args.profile_file->c_str(),
+            profile.error()
+        );
+
+        return 1;
+    }
+
+    auto r = relayout::relayout(mod, *profile);
+
+    if (!r) {
+        std::println(std::cerr, "Could not relayout the module: {}", r.error());
+
+        return 1;
+    }
+
+    if (!write_module(r->mod, *args.output_file)) {
+        return 1;
+    }
+
+    std::println(
+        std::cerr,
+        "Relaid out {} procedures ({} profiled): moved {} cold blocks, inverted {} branches, "
+        "added {} jumps",
+        r->summary.procs,
+        r->summary.profiled_procs,
+        r->summary.cold_blocks,
+        r->summary.inverted_branches,
+        r->summary.added_jumps
+    );
+
+    return 0;
+}
+
+int strip_module(const bytecode::Module &mod, const args::Args &args) {
+    auto r = strip::strip(
+        mod,
+        strip::Opts{
+            .strip_lines = args.strip_lines,
+        }
+    );
+
+    if (!r) {
+        std::println(std::cerr, "Could not strip the module: {}", r.error());
+
+        return 1;
+    }
+
+    if (!write_module(r->mod, *args.output_file)) {
+        return 1;
+    }
+
+    const auto &summary = r->summary;
+    std::println(
+        std::cerr,
+        "Removed {} of {} procedures and {} line markers: bytecode {} -> {} bytes, string table {} "
+        "-> {} bytes",
+        summary.removed_procs,
+        summary.procs,
+        summary.removed_lines,
+        summary.bytecode_size,
+        summary.new_bytecode_size,
+        summary.strtab_size,
+        summary.new_strtab_size
+    );
+
+    return 0;
+}
+
+int print_stats(
+    const bytecode::Module &mod,
+    const verifier::ModuleInfo &mod_info,
+    const args::Args &args
+) {
+    auto stats = stats::collect(mod, mod_info);
+
+    if (!stats) {
+        std::println(std::cerr, "Could not analyze the module: {}", stats.error());
+
+        return 1;
+    }
+
+    if (args.json) {
+        stats::write_json(*stats, std::cout);
+    } else {
+        stats::write_text(*stats, std::cout);
+    }
+
+    return 0;
+}
+
+#ifdef COVERAGE
+void write_coverage(
+    const std::filesystem::path &path,
+    const bytecode::Module &mod,
+    const interpreter::Interpreter &interp
+) {
+    errno = 0;
+    std::ofstream s(path);
+
+    if (!s) {
+        std::println(
+            std::cerr,
+            "Could not open {} for writing: {}",
+            path.c_str(),
+            util::get_last_error().message()
+        );
+
+        return;
+    }
+
+    auto summary = coverage::write_lcov(mod, interp.coverage(), s);
+    std::println(
+        std::cerr,
+        "Coverage: {} of {} instructions, {} of {} lines",
+        summary.instrs_hit,
+        summary.instrs,
+        summary.lines_hit,
+        summary.lines
+    );
+}
+#endif
+
+void print_gc_stats(const heap::Stats &stats, const time::Timings &timings) {
+    using Millis = std::chrono::duration<double, std::milli>;
+
+    std::println(std::cerr, "GC statistics:");
+    std::println(std::cerr, "  - Allocated {} objects ({} bytes)", stats.objects, stats.bytes);
+    std::println(std::cerr, "  - Detected {} collections", stats.collections);
+
+    if (stats.timed_collections == 0) {
+        return;
+    }
+
+    std::println(
+        std::cerr,
+        "  - Pauses: {} total, {} mean, {} max",
+        Millis(stats.gc_time),
+        Millis(stats.gc_time / stats.timed_collections),
+        Millis(stats.max_gc_pause)
+    );
+
+    for (const auto &m : timings.measurements) {
+        if (m.name == "interpretation" && m.elapsed.count() > 0) {
+            std::println(
+                std::cerr,
+                "  - GC overhead: {:.1f}% of the interpretation time",
+                100.0 * stats.gc_time.count() / m.elapsed.count()
+            );
+        }
+    }
+}
+
+void print_memory_stats(
+    const bytecode::Module &mod,
+    const verifier::ModuleInfo *mod_info,
+    const interpreter::Interpreter &interp,
+    const time::Timings &timings
+) {
+    constexpr auto kib = [](uint64_t bytes) { return (bytes + 1023) / 1024; };
+
+    std::println(std::cerr, "Memory usage:");
+    std::println(std::cerr, "  - Peak RSS: {} KiB", kib(util::peak_rss()));
+
+    for (const auto &m : timings.measurements) {
+        std::println(
+            std::cerr,
+            "  - Stage \"{}\" raised the peak RSS by {} KiB",
+            m.name,
+            kib(m.peak_rss_growth)
+        );
+    }
+
+    std::println(
+        std::cerr,
+        "  - Module: {} bytes of bytecode, {} bytes of string table",
+        mod.bytecode.size(),
+        mod.strtab.size()
+    );
+
+    if (mod_info) {
+        std::println(std::cerr, "  - Verifier working memory: ~{} bytes", mod_info->scratch_bytes);
+    }
+
+    const auto &mem = interp.memory_stats();
+    std::println(
+        std::cerr,
+        "  - Value stack high-water: {} values ({} bytes)",
+        mem.stack_high_water,
+        mem.stack_high_water * mem.value_size
+    );
+    std::println(
+        std::cerr,
+        "  - Call stack high-water: {} frames ({} bytes)",
+        mem.max_call_depth,
+        mem.max_call_depth * mem.frame_size
+    );
+    std::println(
+        std::cerr,
+        "  - Heap high-water: at least {} bytes (allocated between two collections)",
+        interp.heap_stats().max_bytes_between_collections
+    );
+}
+
+void write_trace_events(
+    const std::filesystem::path &path,
+    trace_events::Recorder &trace,
+    const time::Timings &timings
+) {
+    for (const auto &m : timings.measurements) {
+        trace.add_span(
+            m.name,
+            "stage",
+            m.start,
+            m.start + std::chrono::duration_cast<trace_events::Clock::duration>(m.elapsed)
+        );
+    }
+
+    errno = 0;
+    std::ofstream s(path);
+
+    if (!s) {
+        std::println(
+            std::cerr,
+            "Could not open {} for writing: {}",
+            path.c_str(),
+            util::get_last_error().message()
+        );
+
+        return;
+    }
+
+    trace.write(s);
+}
+
 } // namespace
 
 int main(int argc, char **argv) {
     auto args = friar::args::Args::parse_or_exit(argc, argv);
+
+    if (args.mode == args::Mode::DecodeTrace) {
+        return decode_trace(args.input_file);
+    }
+
     time::Timings timings;
-    timings.perform_measurements = args.time;
+    timings.perform_measurements =
+        args.time || args.gc_stats || args.mem || args.trace_events_file;
+
+    std::optional<trace_events::Recorder> trace;
+
+    if (args.trace_events_file) {
+        trace.emplace();
+        trace->call_threshold = args.trace_call_threshold;
+    }
 
     auto input = util::open_file(args.input_file);
 
@@ -91,6 +427,14 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    if (args.bulk_input) {
+        if (auto r = bulk_input::bind(*mod); !r) {
+            std::println(std::cerr, "Could not bind the bulk input procedures: {}", r.error());
+
+            return 1;
+        }
+    }
+
     if (args.mode == args::Mode::Disas) {
         return print_disas(*mod);
     }
@@ -98,7 +442,8 @@ int main(int argc, char **argv) {
     std::optional<decltype(verifier::verify(*mod))> mod_info;
 
 #ifdef DYNAMIC_VERIFICATION
-    if (args.mode == args::Mode::Idiom) {
+    if (args.mode == args::Mode::Idiom || args.mode == args::Mode::Relayout
+        || args.mode == args::Mode::Strip || args.mode == args::Mode::Stats) {
 #endif
         mod_info =
             timings.measure("static bytecode verification", [&] { return verifier::verify(*mod); });
@@ -121,16 +466,208 @@ int main(int argc, char **argv) {
         return print_idioms(*mod, **mod_info);
     }
 
-    interpreter::Interpreter interp(
-        *mod,
+    if (args.mode == args::Mode::Relayout) {
+        return relayout_module(*mod, args);
+    }
+
+    if (args.mode == args::Mode::Strip) {
+        return strip_module(*mod, args);
+    }
+
+    if (args.mode == args::Mode::Stats) {
+        return print_stats(*mod, **mod_info, args);
+    }
+
+    // the module is read-only from here on.
+    auto program = timings.measure("program preparation", [&] {
+        return program::Program::prepare(
+            std::move(*mod),
+#ifndef DYNAMIC_VERIFICATION
+            std::move(**mod_info),
+#endif
+            program::Opts{
 #ifndef DYNAMIC_VERIFICATION
-        **mod_info,
+                .scalar_replace = args.scalar_replace,
+#endif
+            }
+        );
+    });
+
+    if (!program) {
+        std::println(std::cerr, "Could not prepare the module: {}", program.error());
+
+        return 1;
+    }
+
+#if INTERPRETER_TRACE
+    if (args.trace_capacity > exec_trace::max_capacity) {
+        std::println(
+            std::cerr, "The trace capacity must not exceed {} records", exec_trace::max_capacity
+        );
+
+        return 1;
+    }
+
+    auto exec_trace =
+        exec_trace::Tracer::open(args.trace_file, args.trace_capacity, INTERPRETER_TRACE >= 2);
+
+    if (!exec_trace) {
+        std::println(
+            std::cerr,
+            "Could not open {} for writing: {}",
+            args.trace_file.c_str(),
+            exec_trace.error().message()
+        );
+
+        return 1;
+    }
+#endif
+
+#ifdef RUNTIME_METRICS
+    metrics::Counters counters;
+    std::optional<metrics::Exporter> metrics_exporter;
+
+    if (args.metrics_file) {
+        metrics_exporter.emplace(program->mod(), counters, *args.metrics_file, args.metrics_interval);
+    }
 #endif
-        std::cin,
-        std::cout
+
+    std::ofstream heap_dump_stream;
+    std::optional<heap_dump::Dumper> heap_dumper;
+
+    if (args.heap_dump_file) {
+        errno = 0;
+        heap_dump_stream.open(*args.heap_dump_file);
+
+        if (!heap_dump_stream) {
+            std::println(
+                std::cerr,
+                "Could not open {} for writing: {}",
+                args.heap_dump_file->c_str(),
+                util::get_last_error().message()
+            );
+
+            return 1;
+        }
+
+        heap_dumper.emplace(heap_dump_stream, args.heap_dump_graph);
+        heap_dumper->at_allocation = args.heap_dump_at;
+        heap_dump::install_signal_handler(SIGUSR1);
+    }
+
+    std::optional<heap::SiteProfile> alloc_sites;
+
+    if (args.alloc_profile_file) {
+        alloc_sites.emplace();
+    }
+
+    // the program talks to the standard streams through plain buffered reads and writes, which
+    // avoids the cost of keeping `std::cin` and `std::cout` in sync with C stdio.
+    std::unique_ptr<std::streambuf> output_buf;
+
+    if (args.async_output) {
+        output_buf = std::make_unique<async_output::Buf>(STDOUT_FILENO);
+    } else {
+        output_buf = std::make_unique<fd_stream::OutBuf>(STDOUT_FILENO);
+    }
+
+    std::ostream output(output_buf.get());
+    exit_output = output_buf.get();
+    std::atexit(flush_exit_output);
+
+    fd_stream::InBuf input_buf(STDIN_FILENO);
+    std::istream program_input(&input_buf);
+
+    // like `std::cin`, flush the output before waiting for input.
+    program_input.tie(&output);
+
+    interpreter::Interpreter interp(
+        *program,
+        program_input,
+        output,
+        interpreter::Opts{
+            .trace = trace ? &*trace : nullptr,
+            .alloc_sites = alloc_sites ? &*alloc_sites : nullptr,
+            .time_collections = args.gc_stats,
+            .max_stack_size = args.max_stack.value_or(interpreter::default_max_stack_size),
+            .max_call_depth = args.max_call_depth.value_or(std::numeric_limits<size_t>::max()),
+            .stack_prealloc = args.stack_prealloc,
+            .heap_dump = heap_dumper ? &*heap_dumper : nullptr,
+#if INTERPRETER_TRACE
+            .exec_trace = &*exec_trace,
+#endif
+#ifdef RUNTIME_METRICS
+            .metrics = metrics_exporter ? &counters : nullptr,
+#endif
+        }
     );
     auto r = timings.measure("interpretation", [&] { return interp.run(); });
 
+    // keeps the program output ahead of the reports and the backtrace.
+    output.flush();
+    exit_output = nullptr;
+
+#ifdef RUNTIME_METRICS
+    // writes the final snapshot.
+    metrics_exporter.reset();
+#endif
+
+    if (trace) {
+        write_trace_events(*args.trace_events_file, *trace, timings);
+    }
+
+    if (args.gc_stats) {
+        print_gc_stats(interp.heap_stats(), timings);
+    }
+
+    if (args.mem) {
+#ifndef DYNAMIC_VERIFICATION
+        print_memory_stats(program->mod(), &program->info(), interp, timings);
+#else
+        print_memory_stats(program->mod(), nullptr, interp, timings);
+#endif
+    }
+
+    if (alloc_sites) {
+        errno = 0;
+        std::ofstream profile(*args.alloc_profile_file);
+
+        if (profile) {
+            alloc_sites->write(program->mod(), profile);
+        } else {
+            std::println(
+                std::cerr,
+                "Could not open {} for writing: {}",
+                args.alloc_profile_file->c_str(),
+                util::get_last_error().message()
+            );
+        }
+    }
+
+#ifdef COVERAGE
+    if (args.coverage_file) {
+        write_coverage(*args.coverage_file, program->mod(), interp);
+    }
+#endif
+
+#ifdef CALL_GRAPH_PROFILER
+    if (args.callgrind_file) {
+        errno = 0;
+        std::ofstream profile(*args.callgrind_file);
+
+        if (profile) {
+            interp.write_profile(profile);
+        } else {
+            std::println(
+                std::cerr,
+                "Could not open {} for writing: {}",
+                args.callgrind_file->c_str(),
+                util::get_last_error().message()
+            );
+        }
+    }
+#endif
+
     if (!r) {
         auto &e = r.error();
         std::println(std::cerr, "Runtime error: {}", e.msg);
@@ -172,7 +709,7 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    if (timings.perform_measurements) {
+    if (args.time) {
         std::println(std::cerr, "Timings:");
         for (const auto &m : timings.measurements) {
             std::chrono::duration<double, std::milli> elapsed = m.elapsed;
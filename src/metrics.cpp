@@ -0,0 +1,226 @@
+#include "metrics.hpp"
+
+#include <cerrno>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <print>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include "util.hpp"
+
+using namespace friar;
+using namespace friar::metrics;
+
+namespace {
+
+void write_metric(
+    std::ostream &s,
+    std::string_view name,
+    std::string_view type,
+    std::string_view help,
+    uint64_t value
+) {
+    std::println(s, "# HELP {} {}", name, help);
+    std::println(s, "# TYPE {} {}", name, type);
+    std::println(s, "{} {}", name, value);
+}
+
+std::string escape_label(std::string_view value) {
+    std::string result;
+
+    for (auto c : value) {
+        switch (c) {
+        case '\\':
+            result += "\\\\";
+            break;
+
+        case '"':
+            result += "\\\"";
+            break;
+
+        case '\n':
+            result += "\\n";
+            break;
+
+        default:
+            result += c;
+        }
+    }
+
+    return result;
+}
+
+} // namespace
+
+Exporter::Exporter(
+    const bytecode::Module &mod,
+    const Counters &counters,
+    std::filesystem::path path,
+    std::chrono::milliseconds interval
+)
+    : counters_(counters), path_(std::move(path)), interval_(interval) {
+    for (const auto &sym : mod.symtab) {
+        proc_names_.emplace(sym.address, escape_label(mod.strtab_entry_at(sym.name)));
+    }
+
+    thread_ = std::jthread([this](std::stop_token stop) { run(std::move(stop)); });
+}
+
+Exporter::~Exporter() {
+    thread_.request_stop();
+    thread_.join();
+    write_file();
+}
+
+void Exporter::run(std::stop_token stop) {
+    std::unique_lock lock(mutex_);
+
+    while (!stop.stop_requested()) {
+        write_file();
+        cv_.wait_for(lock, stop, interval_, [] { return false; });
+    }
+}
+
+void Exporter::write_file() {
+    auto tmp_path = path_;
+    tmp_path += ".tmp";
+
+    errno = 0;
+    std::ofstream s(tmp_path);
+
+    if (s) {
+        write(s);
+        s.close();
+    }
+
+    std::error_code ec;
+
+    if (!s) {
+        ec = util::get_last_error();
+    } else {
+        std::filesystem::rename(tmp_path, path_, ec);
+    }
+
+    if (!ec) {
+        failed_ = false;
+        unreported_failures_ = 0;
+
+        return;
+    }
+
+    // the file is rewritten every interval, so a persistent failure (e.g., a full disk) would
+    // otherwise flood the standard error.
+    auto now = std::chrono::steady_clock::now();
+
+    if (failed_ && now - last_report_ < report_interval) {
+        ++unreported_failures_;
+
+        return;
+    }
+
+    if (unreported_failures_ > 0) {
+        std::println(
+            std::cerr,
+            "Could not write metrics to {}: {} ({} more failures since the last report)",
+            path_.c_str(),
+            ec.message(),
+            unreported_failures_
+        );
+    } else {
+        std::println(std::cerr, "Could not write metrics to {}: {}", path_.c_str(), ec.message());
+    }
+
+    failed_ = true;
+    last_report_ = now;
+    unreported_failures_ = 0;
+}
+
+void Exporter::write(std::ostream &s) const {
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    write_metric(
+        s,
+        "friar_instructions_total",
+        "counter",
+        "Dispatched bytecode instructions.",
+        counters_.instrs.load(relaxed)
+    );
+    write_metric(
+        s, "friar_calls_total", "counter", "Procedure calls.", counters_.calls.load(relaxed)
+    );
+    write_metric(
+        s,
+        "friar_allocated_objects_total",
+        "counter",
+        "Objects allocated on the heap.",
+        counters_.alloc_objects.load(relaxed)
+    );
+    write_metric(
+        s,
+        "friar_allocated_bytes_total",
+        "counter",
+        "Bytes allocated on the heap.",
+        counters_.alloc_bytes.load(relaxed)
+    );
+    write_metric(
+        s,
+        "friar_heap_allocated_since_gc_bytes",
+        "gauge",
+        "Bytes allocated since the last garbage collection.",
+        counters_.heap_bytes_since_gc.load(relaxed)
+    );
+    write_metric(
+        s,
+        "friar_gc_collections_total",
+        "counter",
+        "Detected garbage collections.",
+        counters_.collections.load(relaxed)
+    );
+    write_metric(
+        s,
+        "friar_gc_pause_nanoseconds_total",
+        "counter",
+        "Time spent in allocations that triggered a timed garbage collection.",
+        counters_.gc_pause_ns.load(relaxed)
+    );
+    write_metric(
+        s,
+        "friar_gc_timed_collections_total",
+        "counter",
+        "Garbage collections included in friar_gc_pause_nanoseconds_total.",
+        counters_.timed_collections.load(relaxed)
+    );
+    write_metric(
+        s,
+        "friar_stack_high_water_bytes",
+        "gauge",
+        "The largest size the value stack has reached.",
+        counters_.stack_high_water.load(relaxed)
+    );
+    write_metric(
+        s,
+        "friar_call_depth",
+        "gauge",
+        "The number of active procedure frames.",
+        counters_.call_depth.load(relaxed)
+    );
+
+    auto pc = counters_.pc.load(relaxed);
+    auto proc_addr = counters_.proc_addr.load(relaxed);
+    write_metric(s, "friar_pc", "gauge", "The current instruction address.", pc);
+
+    std::string proc_name;
+
+    if (auto it = proc_names_.find(proc_addr); it != proc_names_.end()) {
+        proc_name = it->second;
+    } else {
+        proc_name = std::format("<anon {:#x}>", proc_addr);
+    }
+
+    std::println(s, "# HELP friar_procedure_info The procedure currently executing.");
+    std::println(s, "# TYPE friar_procedure_info gauge");
+    std::println(s, "friar_procedure_info{{name=\"{}\",addr=\"{:#x}\"}} 1", proc_name, proc_addr);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <ostream>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "bytecode.hpp"
+
+namespace friar::metrics {
+
+/// Runtime counters published by the interpreter.
+///
+/// The interpreter is the only writer; the values are refreshed periodically rather than on every
+/// event, and all accesses are relaxed.
+struct Counters {
+    std::atomic<uint64_t> instrs = 0;
+    std::atomic<uint64_t> calls = 0;
+    std::atomic<uint64_t> alloc_objects = 0;
+    std::atomic<uint64_t> alloc_bytes = 0;
+
+    /// The size of the objects allocated since the last garbage collection.
+    std::atomic<uint64_t> heap_bytes_since_gc = 0;
+
+    std::atomic<uint64_t> collections = 0;
+    std::atomic<uint64_t> gc_pause_ns = 0;
+
+    /// The number of collections included in `gc_pause_ns` (see `heap::Stats::timed_collections`).
+    std::atomic<uint64_t> timed_collections = 0;
+
+    /// The largest size the value stack has reached, in bytes.
+    std::atomic<uint64_t> stack_high_water = 0;
+
+    std::atomic<uint64_t> call_depth = 0;
+    std::atomic<uint32_t> pc = 0;
+    std::atomic<uint32_t> proc_addr = 0;
+};
+
+/// Periodically writes a snapshot of `Counters` to a file in the Prometheus text format.
+///
+/// The file is replaced atomically, so it can be read at any time (e.g., by the node exporter's
+/// textfile collector). The writer runs on a background thread and only ever reads the counters.
+class Exporter {
+public:
+    Exporter(
+        const bytecode::Module &mod,
+        const Counters &counters,
+        std::filesystem::path path,
+        std::chrono::milliseconds interval
+    );
+
+    Exporter(const Exporter &) = delete;
+    Exporter &operator=(const Exporter &) = delete;
+
+    /// Stops the background thread and writes the final snapshot.
+    ~Exporter();
+
+    /// Writes a snapshot of the counters to `s`.
+    void write(std::ostream &s) const;
+
+private:
+    void run(std::stop_token stop);
+    void write_file();
+
+    const Counters &counters_;
+    std::filesystem::path path_;
+    std::chrono::milliseconds interval_;
+    std::unordered_map<uint32_t, std::string> proc_names_;
+
+    // failed writes are reported at most once per `report_interval`.
+    static constexpr std::chrono::seconds report_interval{60};
+    std::chrono::steady_clock::time_point last_report_;
+    uint64_t unreported_failures_ = 0;
+    bool failed_ = false;
+
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::jthread thread_;
+};
+
+} // namespace friar::metrics
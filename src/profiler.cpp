@@ -0,0 +1,88 @@
+#include "profiler.hpp"
+
+#include <format>
+#include <print>
+#include <string>
+#include <unordered_map>
+
+using namespace friar;
+using namespace friar::profiler;
+
+void CallGraphProfiler::enter(uint32_t proc_addr, uint64_t alloc_bytes) {
+    stack_.push_back(
+        ActiveCall{
+            .proc_addr = proc_addr,
+            .start = now(alloc_bytes),
+        }
+    );
+}
+
+void CallGraphProfiler::leave(uint64_t alloc_bytes) {
+    auto call = stack_.back();
+    stack_.pop_back();
+
+    auto inclusive = now(alloc_bytes) - call.start;
+    procs_[call.proc_addr].self += inclusive - call.children;
+
+    if (!stack_.empty()) {
+        auto &caller = stack_.back();
+        caller.children += inclusive;
+
+        auto &edge = procs_[caller.proc_addr].callees[call.proc_addr];
+        ++edge.calls;
+        edge.inclusive += inclusive;
+    }
+}
+
+void CallGraphProfiler::finish(uint64_t alloc_bytes) {
+    while (!stack_.empty()) {
+        leave(alloc_bytes);
+    }
+}
+
+void CallGraphProfiler::write_callgrind(const bytecode::Module &mod, std::ostream &s) const {
+    std::unordered_map<uint32_t, std::string_view> sym_names;
+
+    for (const auto &sym : mod.symtab) {
+        sym_names.emplace(sym.address, mod.strtab_entry_at(sym.name));
+    }
+
+    auto proc_name = [&](uint32_t addr) -> std::string {
+        if (auto it = sym_names.find(addr); it != sym_names.end()) {
+            return std::string(it->second);
+        }
+
+        return std::format("<anon {:#x}>", addr);
+    };
+
+    Costs totals;
+
+    for (const auto &[_, proc] : procs_) {
+        totals += proc.self;
+    }
+
+    std::println(s, "version: 1");
+    std::println(s, "creator: friar");
+    std::println(s, "cmd: {}", mod.name);
+    std::println(s, "positions: instr");
+    std::println(s, "event: Ir : Dispatched instructions");
+    std::println(s, "event: Alloc : Allocated bytes");
+    std::println(s, "events: Ir Alloc");
+    std::println(s, "totals: {} {}", totals.instrs, totals.alloc_bytes);
+    std::println(s, "");
+    std::println(s, "fl={}", mod.name);
+
+    for (const auto &[addr, proc] : procs_) {
+        std::println(s, "");
+        std::println(s, "fn={}", proc_name(addr));
+        std::println(s, "{:#x} {} {}", addr, proc.self.instrs, proc.self.alloc_bytes);
+
+        for (const auto &[callee_addr, edge] : proc.callees) {
+            std::println(s, "cfn={}", proc_name(callee_addr));
+            std::println(s, "calls={} {:#x}", edge.calls, callee_addr);
+            std::println(
+                s, "{:#x} {} {}", addr, edge.inclusive.instrs, edge.inclusive.alloc_bytes
+            );
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include "bytecode.hpp"
+
+namespace friar::profiler {
+
+/// Costs attributed to a procedure.
+struct Costs {
+    /// The number of dispatched instructions.
+    uint64_t instrs = 0;
+
+    /// The number of bytes allocated on the heap.
+    uint64_t alloc_bytes = 0;
+
+    Costs &operator+=(const Costs &other) noexcept {
+        instrs += other.instrs;
+        alloc_bytes += other.alloc_bytes;
+
+        return *this;
+    }
+
+    Costs operator-(const Costs &other) const noexcept {
+        return {
+            .instrs = instrs - other.instrs,
+            .alloc_bytes = alloc_bytes - other.alloc_bytes,
+        };
+    }
+};
+
+/// An exact (instrumenting) call-graph profiler.
+///
+/// Records the number of calls between each pair of procedures and their inclusive and exclusive
+/// costs.
+class CallGraphProfiler {
+public:
+    /// Counts a dispatched instruction.
+    void dispatch() noexcept {
+        ++instrs_;
+    }
+
+    /// Records a call to the procedure at `proc_addr`.
+    ///
+    /// `alloc_bytes` is the total number of bytes allocated so far.
+    void enter(uint32_t proc_addr, uint64_t alloc_bytes);
+
+    /// Records a return from the innermost active procedure.
+    void leave(uint64_t alloc_bytes);
+
+    /// Attributes the remaining costs to the procedures that are still active.
+    void finish(uint64_t alloc_bytes);
+
+    /// Writes the collected profile in the Callgrind format.
+    void write_callgrind(const bytecode::Module &mod, std::ostream &s) const;
+
+private:
+    struct ActiveCall {
+        uint32_t proc_addr = 0;
+
+        // the costs at the time of the call.
+        Costs start;
+
+        // the inclusive costs of the calls made by this procedure.
+        Costs children;
+    };
+
+    struct CallEdge {
+        uint64_t calls = 0;
+        Costs inclusive;
+    };
+
+    struct ProcProfile {
+        Costs self;
+
+        // keyed by the callee's address.
+        std::map<uint32_t, CallEdge> callees;
+    };
+
+    Costs now(uint64_t alloc_bytes) const noexcept {
+        return {.instrs = instrs_, .alloc_bytes = alloc_bytes};
+    }
+
+    uint64_t instrs_ = 0;
+    std::vector<ActiveCall> stack_;
+    std::map<uint32_t, ProcProfile> procs_;
+};
+
+} // namespace friar::profiler
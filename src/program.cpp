@@ -0,0 +1,38 @@
+#include "program.hpp"
+
+#include <utility>
+
+#include "rewrite.hpp"
+#include "tuple_return.hpp"
+
+using namespace friar;
+using namespace friar::program;
+
+std::expected<Program, std::string> Program::prepare(
+    bytecode::Module mod,
+#ifndef DYNAMIC_VERIFICATION
+    verifier::ModuleInfo info,
+#endif
+    [[maybe_unused]] const Opts &opts
+) {
+    Program result;
+    result.mod_ = std::move(mod);
+
+#ifndef DYNAMIC_VERIFICATION
+    result.info_ = std::move(info);
+
+    // the interpreter trusts verified bytecode, so the tuples returned to destructuring callers can
+    // be passed as separate values. this analyzes the whole module before the run starts.
+    if (opts.scalar_replace) {
+        auto code = rewrite::decode_code(result.mod_);
+
+        if (!code) {
+            return std::unexpected(std::move(code).error());
+        }
+
+        tuple_return::scalar_replace(result.mod_, *code);
+    }
+#endif
+
+    return result;
+}
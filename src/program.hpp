@@ -0,0 +1,60 @@
+#pragma once
+
+#include <expected>
+#include <string>
+
+#include "config.hpp"
+#include "bytecode.hpp"
+#include "verifier.hpp"
+
+namespace friar::program {
+
+/// Options for `Program::prepare`.
+struct Opts {
+#ifndef DYNAMIC_VERIFICATION
+    /// Whether to apply `tuple_return::scalar_replace`.
+    bool scalar_replace = false;
+#endif
+};
+
+/// A module ready to be interpreted.
+///
+/// `prepare` makes the last changes to the module, and the program is read-only afterwards: its
+/// bytecode, its string table (which S-expression tags point into), and the procedure table
+/// computed by the verifier can back any number of interpreters. Each interpreter keeps the state
+/// of its runs (the stacks, the frames with their current lines, and the heap) to itself.
+class Program {
+public:
+    /// Takes over a loaded module, applying the transformations that follow verification.
+    ///
+    /// The transformations that precede verification (such as `bulk_input::bind`) must already
+    /// have been applied, and `info` must be the result of verifying `mod`.
+    static std::expected<Program, std::string> prepare(
+        bytecode::Module mod,
+#ifndef DYNAMIC_VERIFICATION
+        verifier::ModuleInfo info,
+#endif
+        const Opts &opts
+    );
+
+    const bytecode::Module &mod() const noexcept {
+        return mod_;
+    }
+
+#ifndef DYNAMIC_VERIFICATION
+    const verifier::ModuleInfo &info() const noexcept {
+        return info_;
+    }
+#endif
+
+private:
+    Program() = default;
+
+    bytecode::Module mod_;
+
+#ifndef DYNAMIC_VERIFICATION
+    verifier::ModuleInfo info_;
+#endif
+};
+
+} // namespace friar::program
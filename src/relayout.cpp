@@ -0,0 +1,245 @@
+#include "relayout.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <format>
+#include <optional>
+#include <set>
+#include <string_view>
+#include <vector>
+
+#include "rewrite.hpp"
+
+using namespace friar;
+using namespace friar::relayout;
+using friar::bytecode::Instr;
+
+namespace {
+
+struct Block {
+    uint32_t start = 0;
+    uint32_t end = 0;
+
+    // the target of the conditional jump ending the block, if any.
+    std::optional<uint32_t> branch_target;
+
+    bool falls_through = false;
+    bool cold = false;
+};
+
+std::optional<uint64_t> parse_number(std::string_view s, int base) {
+    uint64_t result = 0;
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), result, base);
+
+    if (ec != std::errc() || ptr != s.data() + s.size()) {
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+std::vector<Block> split_blocks(const rewrite::Code &code, const rewrite::Proc &proc) {
+    std::set<uint32_t> leaders{proc.addr};
+
+    for (size_t i = proc.first; i < proc.last; ++i) {
+        const auto &instr = code.instrs[i];
+        bool is_jump = instr.opcode == Instr::Jmp || instr.opcode == Instr::CjmpZ
+            || instr.opcode == Instr::CjmpNz;
+
+        if (is_jump && instr.target >= proc.addr && instr.target < proc.end) {
+            leaders.insert(instr.target);
+        }
+
+        if ((is_jump || !instr.falls_through()) && instr.end < proc.end) {
+            leaders.insert(instr.end);
+        }
+    }
+
+    std::vector<Block> blocks;
+
+    for (size_t i = proc.first; i < proc.last; ++i) {
+        const auto &instr = code.instrs[i];
+
+        if (leaders.contains(instr.addr)) {
+            blocks.push_back(Block{.start = instr.addr});
+        }
+
+        bool is_branch = instr.opcode == Instr::CjmpZ || instr.opcode == Instr::CjmpNz;
+        blocks.back().end = instr.end;
+        blocks.back().branch_target =
+            is_branch ? std::optional<uint32_t>(instr.target) : std::nullopt;
+        blocks.back().falls_through = instr.falls_through();
+        blocks.back().cold = instr.opcode == Instr::Fail;
+    }
+
+    // the entry block stays in place, and so does the last one: the verifier expects the next
+    // procedure right after the final `END`.
+    blocks.front().cold = false;
+    blocks.back().cold = false;
+
+    return blocks;
+}
+
+} // namespace
+
+std::expected<Profile, std::string> friar::relayout::read_callgrind(std::istream &s) {
+    Profile profile;
+    std::string line;
+    bool expect_self_cost = false;
+
+    // the profiler writes each procedure's self cost right after its `fn=` line, and the
+    // inclusive cost of each call after a `calls=` line.
+    while (std::getline(s, line)) {
+        if (line.starts_with("fn=")) {
+            expect_self_cost = true;
+
+            continue;
+        }
+
+        if (!expect_self_cost || !line.starts_with("0x")) {
+            continue;
+        }
+
+        expect_self_cost = false;
+        std::string_view rest(line);
+        rest.remove_prefix(2);
+
+        auto addr_end = rest.find(' ');
+        auto instrs_end = rest.find(' ', addr_end + 1);
+
+        if (addr_end == std::string_view::npos) {
+            return std::unexpected(std::format("malformed cost line: {}", line));
+        }
+
+        auto addr = parse_number(rest.substr(0, addr_end), 16);
+        auto instrs = parse_number(rest.substr(addr_end + 1, instrs_end - addr_end - 1), 10);
+
+        if (!addr || !instrs || *addr > UINT32_MAX) {
+            return std::unexpected(std::format("malformed cost line: {}", line));
+        }
+
+        profile.proc_instrs[static_cast<uint32_t>(*addr)] += *instrs;
+    }
+
+    if (profile.proc_instrs.empty()) {
+        return std::unexpected("the profile has no procedure costs");
+    }
+
+    return profile;
+}
+
+std::expected<Result, std::string>
+friar::relayout::relayout(const bytecode::Module &mod, const Profile &profile) {
+    auto code = rewrite::decode_code(mod);
+
+    if (!code) {
+        return std::unexpected(std::move(code).error());
+    }
+
+    if (code->procs.empty() || code->procs.front().addr != 0) {
+        return std::unexpected("the module has no main procedure");
+    }
+
+    Summary summary{
+        .procs = static_cast<uint32_t>(code->procs.size()),
+    };
+
+    auto hotness = [&](const rewrite::Proc &proc) -> uint64_t {
+        auto it = profile.proc_instrs.find(proc.addr);
+
+        return it == profile.proc_instrs.end() ? 0 : it->second;
+    };
+
+    std::vector<const rewrite::Proc *> procs;
+
+    for (const auto &proc : code->procs) {
+        procs.push_back(&proc);
+
+        if (profile.proc_instrs.contains(proc.addr)) {
+            ++summary.profiled_procs;
+        }
+    }
+
+    // the main procedure must remain at address 0.
+    std::stable_sort(procs.begin() + 1, procs.end(), [&](const auto *lhs, const auto *rhs) {
+        return hotness(*lhs) > hotness(*rhs);
+    });
+
+    std::vector<rewrite::Fragment> fragments;
+
+    auto place = [&](const Block &block, rewrite::Fragment tail) {
+        if (!fragments.empty() && !fragments.back().jump_to && !fragments.back().invert_to
+            && fragments.back().end == block.start) {
+            fragments.back().end = block.end;
+            fragments.back().jump_to = tail.jump_to;
+            fragments.back().invert_to = tail.invert_to;
+        } else {
+            tail.start = block.start;
+            tail.end = block.end;
+            fragments.push_back(tail);
+        }
+
+        if (tail.jump_to) {
+            ++summary.added_jumps;
+        }
+
+        if (tail.invert_to) {
+            ++summary.inverted_branches;
+        }
+    };
+
+    for (const auto *proc : procs) {
+        auto blocks = split_blocks(*code, *proc);
+        std::vector<size_t> hot;
+        std::vector<size_t> cold;
+
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            (blocks[i].cold ? cold : hot).push_back(i);
+        }
+
+        summary.cold_blocks += cold.size();
+
+        // put the cold blocks after the last hot block that does not fall through (so that no
+        // jump is needed to skip them), but before the final one.
+        size_t split = hot.size() - 1;
+
+        for (size_t k = hot.size() - 1; k-- > 0;) {
+            if (!blocks[hot[k]].falls_through) {
+                split = k + 1;
+
+                break;
+            }
+        }
+
+        std::vector<size_t> order(hot.begin(), hot.begin() + split);
+        order.insert(order.end(), cold.begin(), cold.end());
+        order.insert(order.end(), hot.begin() + split, hot.end());
+
+        for (size_t j = 0; j < order.size(); ++j) {
+            const auto &block = blocks[order[j]];
+            const auto *next = j + 1 < order.size() ? &blocks[order[j + 1]] : nullptr;
+            rewrite::Fragment tail;
+
+            bool moved_away = !next || next->start != block.end;
+
+            if (block.falls_through && block.end < proc->end && moved_away) {
+                if (next && block.branch_target == next->start) {
+                    // branch to the original successor instead, and fall through to the target.
+                    tail.invert_to = block.end;
+                } else {
+                    tail.jump_to = block.end;
+                }
+            }
+
+            place(block, tail);
+        }
+    }
+
+    return rewrite::assemble(mod, *code, fragments).transform([&](auto new_mod) {
+        return Result{
+            .mod = std::move(new_mod),
+            .summary = summary,
+        };
+    });
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <istream>
+#include <string>
+#include <unordered_map>
+
+#include "bytecode.hpp"
+
+namespace friar::relayout {
+
+/// Procedure hotness, as recorded by the call-graph profiler.
+struct Profile {
+    /// The number of instructions dispatched in each procedure itself, keyed by its address.
+    std::unordered_map<uint32_t, uint64_t> proc_instrs;
+};
+
+/// Reads a profile written by `--callgrind-out`.
+std::expected<Profile, std::string> read_callgrind(std::istream &s);
+
+/// What the relayout has done.
+struct Summary {
+    uint32_t procs = 0;
+    uint32_t profiled_procs = 0;
+    uint32_t cold_blocks = 0;
+    uint32_t inverted_branches = 0;
+    uint32_t added_jumps = 0;
+};
+
+struct Result {
+    bytecode::Module mod;
+    Summary summary;
+};
+
+/// Rearranges the code of a verified module for instruction-fetch locality.
+///
+/// The main procedure stays first, and the rest are ordered from the hottest to the coldest
+/// according to `profile`, so hot code is packed together. Within each procedure, blocks that end
+/// in `FAIL` are moved out of the way of the code around them. Where a block no longer falls
+/// through to its successor, its conditional jump is inverted if possible, and a `JMP` is added
+/// otherwise.
+std::expected<Result, std::string> relayout(const bytecode::Module &mod, const Profile &profile);
+
+} // namespace friar::relayout
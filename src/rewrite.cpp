@@ -0,0 +1,328 @@
+#include "rewrite.hpp"
+
+#include <algorithm>
+#include <format>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+
+#include "decode.hpp"
+#include "util.hpp"
+
+using namespace friar;
+using namespace friar::rewrite;
+using friar::bytecode::Instr;
+
+namespace {
+
+bool has_code_target(Instr opcode) noexcept {
+    switch (opcode) {
+    case Instr::Jmp:
+    case Instr::CjmpZ:
+    case Instr::CjmpNz:
+    case Instr::Call:
+    case Instr::Closure:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+bool has_string(Instr opcode) noexcept {
+    switch (opcode) {
+    case Instr::String:
+    case Instr::Sexp:
+    case Instr::Tag:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+struct Placement {
+    // the lowest original address relocated into this placement.
+    uint32_t from = 0;
+
+    uint32_t start = 0;
+    uint32_t end = 0;
+    uint32_t new_start = 0;
+};
+
+void store_u32(std::vector<Instr> &bytecode, uint32_t addr, uint32_t value) {
+    std::span<std::byte, 4> bytes(std::as_writable_bytes(std::span(bytecode).subspan(addr, 4)));
+    util::to_u32_le(bytes, value);
+}
+
+} // namespace
+
+bool Instruction::falls_through() const noexcept {
+    switch (opcode) {
+    case Instr::Jmp:
+    case Instr::End:
+    case Instr::Ret:
+    case Instr::Fail:
+    case Instr::Eof:
+        return false;
+
+    default:
+        return true;
+    }
+}
+
+const Proc *Code::proc_at(uint32_t addr) const noexcept {
+    auto it = std::ranges::upper_bound(procs, addr, {}, &Proc::addr);
+
+    if (it == procs.begin() || addr >= std::prev(it)->end) {
+        return nullptr;
+    }
+
+    return &*std::prev(it);
+}
+
+std::expected<Code, std::string> friar::rewrite::decode_code(const bytecode::Module &mod) {
+    Code code;
+    decode::Decoder decoder(mod.bytecode);
+    std::optional<std::string> error;
+
+    while (true) {
+        Instruction instr;
+        bool first_imm = true;
+
+        decoder.next([&](const decode::Decoder::Result &result) {
+            std::visit(
+                util::overloaded{
+                    [&](const decode::InstrStart &start) {
+                        instr.addr = start.addr;
+                        instr.opcode = start.opcode;
+                    },
+
+                    [&](const decode::Imm32 &imm) {
+                        if (first_imm && has_code_target(instr.opcode)) {
+                            instr.target_imm = imm.addr;
+                            instr.target = imm.imm;
+                        } else if (first_imm && has_string(instr.opcode)) {
+                            instr.string_imm = imm.addr;
+                            instr.string = imm.imm;
+                        }
+
+                        first_imm = false;
+                    },
+
+                    [&](const decode::InstrEnd &end) { instr.end = end.end(); },
+
+                    [&](const decode::Error &e) {
+                        if (!error) {
+                            error = std::format("{} (at {:#x})", e.msg, e.addr);
+                        }
+                    },
+
+                    [](const auto &) {},
+                },
+                result
+            );
+        });
+
+        if (error) {
+            return std::unexpected(std::move(*error));
+        }
+
+        if (instr.opcode == Instr::Eof) {
+            break;
+        }
+
+        if (instr.opcode == Instr::Begin || instr.opcode == Instr::Cbegin) {
+            if (!code.procs.empty()) {
+                code.procs.back().end = instr.addr;
+                code.procs.back().last = code.instrs.size();
+            }
+
+            code.procs.push_back(
+                Proc{
+                    .addr = instr.addr,
+                    .first = code.instrs.size(),
+                }
+            );
+        } else if (code.procs.empty()) {
+            return std::unexpected(
+                std::format("found an instruction outside of any procedure at {:#x}", instr.addr)
+            );
+        }
+
+        code.instrs.push_back(instr);
+    }
+
+    if (!code.procs.empty()) {
+        code.procs.back().end = code.instrs.back().end;
+        code.procs.back().last = code.instrs.size();
+    }
+
+    return code;
+}
+
+std::expected<bytecode::Module, std::string> friar::rewrite::assemble(
+    const bytecode::Module &mod,
+    const Code &code,
+    std::span<const Fragment> fragments
+) {
+    constexpr uint32_t jmp_len = 1 + sizeof(uint32_t);
+
+    if (fragments.empty() || fragments.front().start != 0) {
+        return std::unexpected("the main procedure must be placed first");
+    }
+
+    std::vector<Placement> placements;
+    uint64_t size = 0;
+
+    for (const auto &fragment : fragments) {
+        placements.push_back(
+            Placement{
+                .from = fragment.aliased_from.value_or(fragment.start),
+                .start = fragment.start,
+                .end = fragment.end,
+                .new_start = static_cast<uint32_t>(size),
+            }
+        );
+        size += fragment.end - fragment.start + (fragment.jump_to ? jmp_len : 0);
+
+        if (size >= std::numeric_limits<int32_t>::max()) {
+            return std::unexpected("the rewritten bytecode is too large");
+        }
+    }
+
+    std::ranges::sort(placements, {}, &Placement::from);
+
+    auto relocate = [&](uint32_t addr) -> std::optional<uint32_t> {
+        auto it = std::ranges::upper_bound(placements, addr, {}, &Placement::from);
+
+        if (it == placements.begin() || addr >= std::prev(it)->end) {
+            return std::nullopt;
+        }
+
+        --it;
+
+        return it->new_start + (std::max(addr, it->start) - it->start);
+    };
+
+    bytecode::Module result{
+        .name = mod.name,
+        .global_count = mod.global_count,
+        .strtab = mod.strtab,
+    };
+    auto &bc = result.bytecode;
+    bc.reserve(size + 1);
+
+    for (const auto &fragment : fragments) {
+        auto new_start = static_cast<uint32_t>(bc.size());
+        bc.insert(
+            bc.end(), mod.bytecode.begin() + fragment.start, mod.bytecode.begin() + fragment.end
+        );
+
+        auto first = std::ranges::lower_bound(code.instrs, fragment.start, {}, &Instruction::addr);
+
+        for (auto it = first; it != code.instrs.end() && it->addr < fragment.end; ++it) {
+            if (!it->target_imm) {
+                continue;
+            }
+
+            auto original_target = it->target;
+
+            if (fragment.invert_to && it->end == fragment.end) {
+                auto opcode_addr = new_start + (it->addr - fragment.start);
+
+                switch (it->opcode) {
+                case Instr::CjmpZ:
+                    bc[opcode_addr] = Instr::CjmpNz;
+                    break;
+
+                case Instr::CjmpNz:
+                    bc[opcode_addr] = Instr::CjmpZ;
+                    break;
+
+                default:
+                    return std::unexpected(
+                        std::format("the instruction at {:#x} is not a conditional jump", it->addr)
+                    );
+                }
+
+                original_target = *fragment.invert_to;
+            }
+
+            auto target = relocate(original_target);
+
+            if (!target) {
+                return std::unexpected(std::format(
+                    "the instruction at {:#x} refers to {:#x}, which is not kept",
+                    it->addr,
+                    original_target
+                ));
+            }
+
+            store_u32(bc, new_start + (*it->target_imm - fragment.start), *target);
+        }
+
+        if (fragment.jump_to) {
+            auto target = relocate(*fragment.jump_to);
+
+            if (!target) {
+                return std::unexpected(std::format(
+                    "the fall-through successor {:#x} of {:#x} is not kept",
+                    *fragment.jump_to,
+                    fragment.end
+                ));
+            }
+
+            bc.push_back(Instr::Jmp);
+            bc.resize(bc.size() + sizeof(uint32_t));
+            store_u32(bc, static_cast<uint32_t>(bc.size() - sizeof(uint32_t)), *target);
+        }
+    }
+
+    bc.push_back(Instr::Eof);
+
+    for (const auto &sym : mod.symtab) {
+        if (auto addr = relocate(sym.address)) {
+            result.symtab.push_back(
+                bytecode::Sym{
+                    .address = *addr,
+                    .name = sym.name,
+                }
+            );
+        }
+    }
+
+    return result;
+}
+
+void friar::rewrite::compact_strtab(bytecode::Module &mod, const Code &code) {
+    std::vector<char> strtab;
+    std::unordered_map<std::string_view, uint32_t> offsets;
+
+    auto intern = [&](uint32_t offset) {
+        auto s = mod.strtab_entry_at(offset);
+        auto [it, inserted] = offsets.emplace(s, static_cast<uint32_t>(strtab.size()));
+
+        if (inserted) {
+            strtab.insert(strtab.end(), s.begin(), s.end());
+            strtab.push_back('\0');
+        }
+
+        return it->second;
+    };
+
+    for (auto &sym : mod.symtab) {
+        sym.name = intern(sym.name);
+    }
+
+    for (const auto &instr : code.instrs) {
+        if (instr.string_imm) {
+            store_u32(mod.bytecode, *instr.string_imm, intern(instr.string));
+        }
+    }
+
+    mod.strtab = std::move(strtab);
+    mod.symtab_map.clear();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "bytecode.hpp"
+
+namespace friar::rewrite {
+
+/// A decoded instruction.
+struct Instruction {
+    /// The address of the opcode.
+    uint32_t addr = 0;
+
+    /// The address of the byte following the instruction.
+    uint32_t end = 0;
+
+    bytecode::Instr opcode = bytecode::Instr::Eof;
+
+    /// The address of the immediate holding a code address (a jump, call, or closure target).
+    std::optional<uint32_t> target_imm;
+
+    /// The code address stored in `target_imm`.
+    uint32_t target = 0;
+
+    /// The address of the immediate holding a string table offset (a string or a tag).
+    std::optional<uint32_t> string_imm;
+
+    /// The string table offset stored in `string_imm`.
+    uint32_t string = 0;
+
+    /// Whether execution can continue with the next instruction.
+    bool falls_through() const noexcept;
+};
+
+/// A procedure: the instructions from a `BEGIN` or `CBEGIN` up to the next one.
+struct Proc {
+    uint32_t addr = 0;
+    uint32_t end = 0;
+
+    /// The range of the procedure's instructions in `Code::instrs`.
+    size_t first = 0;
+    size_t last = 0;
+};
+
+/// The bytecode of a module, decoded linearly.
+struct Code {
+    /// All instructions, excluding the end-of-file marker.
+    std::vector<Instruction> instrs;
+
+    std::vector<Proc> procs;
+
+    /// Returns the procedure containing `addr`, if any.
+    const Proc *proc_at(uint32_t addr) const noexcept;
+};
+
+/// Decodes the bytecode of a verified module.
+std::expected<Code, std::string> decode_code(const bytecode::Module &mod);
+
+/// A range of the original bytecode placed in a rewritten module.
+struct Fragment {
+    uint32_t start = 0;
+    uint32_t end = 0;
+
+    /// If set, original addresses in `[aliased_from, start)`, which belong to dropped code, are
+    /// relocated to the fragment's start.
+    std::optional<uint32_t> aliased_from;
+
+    /// If set, a `JMP` to this original address is placed after the fragment.
+    std::optional<uint32_t> jump_to;
+
+    /// If set, the conditional jump that ends the fragment is inverted and retargeted to this
+    /// original address.
+    std::optional<uint32_t> invert_to;
+};
+
+/// Builds a module from `fragments` of `mod`'s bytecode, placed in order.
+///
+/// Every jump, call, and closure target is relocated and must lie within some fragment. Symbols
+/// pointing outside the fragments are dropped. The first fragment must start with the main
+/// procedure.
+std::expected<bytecode::Module, std::string>
+assemble(const bytecode::Module &mod, const Code &code, std::span<const Fragment> fragments);
+
+/// Drops the string table entries that neither the code nor the symbol table refers to, merging
+/// duplicate strings. `code` must be the decoded bytecode of `mod`.
+void compact_strtab(bytecode::Module &mod, const Code &code);
+
+} // namespace friar::rewrite
@@ -0,0 +1,100 @@
+#include "stack.hpp"
+
+#include <cerrno>
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "util.hpp"
+
+using namespace friar;
+using namespace friar::stack;
+
+namespace {
+
+// the size of a transparent huge page with 4 KiB base pages (on x86-64 and AArch64).
+constexpr size_t huge_page_size = size_t(2) << 20;
+
+size_t round_up(size_t size, size_t alignment) noexcept {
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+size_t round_to_page(size_t size) noexcept {
+    static const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    return round_up(size, page_size);
+}
+
+// returns the offset into a reservation starting at `addr` past which huge pages are requested:
+// the first huge page boundary at least `huge_page_size` bytes in.
+//
+// the bottom of the stack is left to small pages so that short runs do not fault in (and zero) a
+// whole huge page.
+size_t huge_pages_offset(const void *addr) noexcept {
+    auto base = reinterpret_cast<uintptr_t>(addr);
+
+    return round_up(base + huge_page_size, huge_page_size) - base;
+}
+
+} // namespace
+
+std::expected<Reservation, std::error_code>
+friar::stack::reserve(size_t max_size, size_t min_size) {
+    auto size = round_to_page(max_size);
+    min_size = std::min(round_to_page(min_size), size);
+
+    while (true) {
+        errno = 0;
+        void *addr = mmap(
+            nullptr,
+            size,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+            -1,
+            0
+        );
+
+        if (addr != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+            // only a hint: failure (e.g., if THP is disabled) is not an error.
+            if (auto offset = huge_pages_offset(addr); offset < size) {
+                madvise(static_cast<std::byte *>(addr) + offset, size - offset, MADV_HUGEPAGE);
+            }
+#endif
+
+            return Reservation{
+                .addr = addr,
+                .size = size,
+            };
+        }
+
+        if (errno != ENOMEM || size <= min_size) {
+            return std::unexpected(util::get_last_error());
+        }
+
+        // the system may be configured not to overcommit memory: try a smaller reservation.
+        size = std::max(round_to_page(size / 2), min_size);
+    }
+}
+
+void friar::stack::release(Reservation reservation) noexcept {
+    if (reservation.addr) {
+        munmap(reservation.addr, reservation.size);
+    }
+}
+
+void friar::stack::discard(Reservation reservation, size_t from, size_t to) noexcept {
+    auto start = round_to_page(from);
+    auto end = std::min(round_to_page(to), reservation.size);
+
+    // discarding a part of a huge page would split it: keep the one that is still partially in use.
+    if (auto offset = huge_pages_offset(reservation.addr); start > offset) {
+        start = offset + round_up(start - offset, huge_page_size);
+    }
+
+    if (start < end) {
+        // if this fails, the memory simply stays committed.
+        madvise(static_cast<std::byte *>(reservation.addr) + start, end - start, MADV_DONTNEED);
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <expected>
+#include <system_error>
+#include <utility>
+
+namespace friar::stack {
+
+/// A range of reserved virtual memory.
+struct Reservation {
+    void *addr = nullptr;
+    size_t size = 0;
+};
+
+/// Reserves `max_size` bytes of address space without committing memory to it.
+///
+/// If the system refuses a reservation this large, smaller ones are attempted, down to `min_size`
+/// bytes. The region past the first 2 MiB is marked as eligible for transparent huge pages.
+std::expected<Reservation, std::error_code> reserve(size_t max_size, size_t min_size);
+
+/// Returns a reservation to the system.
+void release(Reservation reservation) noexcept;
+
+/// Returns the memory backing the pages of a reservation that start in the bytes `[from, to)` to
+/// the system. Huge pages are only discarded whole. The address space stays reserved, and the
+/// discarded pages read as zeros when next touched.
+void discard(Reservation reservation, size_t from, size_t to) noexcept;
+
+/// A stack of trivially copyable values backed by a single virtual memory reservation.
+///
+/// The stack never moves: it grows in place within the reservation, so `data()` stays valid for
+/// its whole lifetime and growth never copies. Pages are only backed by memory once touched, and
+/// touched pages are kept for reuse when the stack is resized down; `shrink()` returns them to the
+/// system instead.
+template<class T>
+class Stack {
+public:
+    /// Creates a stack that can hold up to `max_size` elements (or fewer if the system does not
+    /// allow reserving that much memory, but at least `min_size`).
+    static std::expected<Stack, std::error_code> create(size_t max_size, size_t min_size) {
+        return reserve(max_size * sizeof(T), min_size * sizeof(T)).transform([](auto r) {
+            return Stack(r);
+        });
+    }
+
+    Stack(Stack &&other) noexcept
+        : reservation_(std::exchange(other.reservation_, {}))
+        , size_(std::exchange(other.size_, 0)) {}
+
+    Stack &operator=(Stack &&other) = delete;
+
+    ~Stack() {
+        release(reservation_);
+    }
+
+    T *data() const noexcept {
+        return static_cast<T *>(reservation_.addr);
+    }
+
+    size_t size() const noexcept {
+        return size_;
+    }
+
+    /// The maximum number of elements the stack can hold.
+    size_t max_size() const noexcept {
+        return reservation_.size / sizeof(T);
+    }
+
+    /// Resizes the stack to `new_size` elements, filling new elements with `value`.
+    ///
+    /// `new_size` must not exceed `max_size()`.
+    void resize(size_t new_size, T value) noexcept {
+        if (new_size > size_) {
+            std::fill(data() + size_, data() + new_size, value);
+        }
+
+        size_ = new_size;
+    }
+
+    /// Shrinks the stack to `new_size` elements and returns the memory past them to the system.
+    ///
+    /// `new_size` must not exceed `size()`.
+    void shrink(size_t new_size) noexcept {
+        discard(reservation_, new_size * sizeof(T), size_ * sizeof(T));
+        size_ = new_size;
+    }
+
+    /// Appends `value` to the stack. The stack must not be full.
+    void push_back(T value) noexcept {
+        data()[size_++] = value;
+    }
+
+private:
+    explicit Stack(Reservation reservation) noexcept : reservation_(reservation) {}
+
+    Reservation reservation_;
+    size_t size_ = 0;
+};
+
+} // namespace friar::stack
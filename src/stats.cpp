@@ -0,0 +1,305 @@
+#include "stats.hpp"
+
+#include <algorithm>
+#include <format>
+#include <print>
+#include <utility>
+
+#include "callgraph.hpp"
+#include "disas.hpp"
+#include "rewrite.hpp"
+#include "tuple_return.hpp"
+#include "util.hpp"
+
+using namespace friar;
+using namespace friar::stats;
+using friar::bytecode::Instr;
+
+namespace {
+
+bool allocates(Instr opcode) noexcept {
+    switch (opcode) {
+    case Instr::String:
+    case Instr::Sexp:
+    case Instr::Closure:
+    case Instr::CallLstring:
+    case Instr::CallBarray:
+    case Instr::CallLreadAll:
+    case Instr::CallLreadLine:
+    case Instr::CallLreadFile:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+// returns the entries of `mix` ordered by the number of occurrences, most frequent first.
+std::vector<std::pair<std::string_view, uint32_t>> by_frequency(const InstrMix &mix) {
+    using Entry = std::pair<std::string_view, uint32_t>;
+    std::vector<Entry> result(mix.begin(), mix.end());
+    std::ranges::stable_sort(result, std::ranges::greater{}, &Entry::second);
+
+    return result;
+}
+
+void write_json_mix(const InstrMix &mix, std::ostream &s) {
+    s << "{";
+    bool first = true;
+
+    for (const auto &[name, count] : mix) {
+        s << (first ? "" : ", ");
+        util::write_json_string(s, name);
+        std::print(s, ": {}", count);
+        first = false;
+    }
+
+    s << "}";
+}
+
+} // namespace
+
+std::expected<ModuleStats, std::string>
+friar::stats::collect(const bytecode::Module &mod, const verifier::ModuleInfo &info) {
+    auto code = rewrite::decode_code(mod);
+
+    if (!code) {
+        return std::unexpected(std::move(code).error());
+    }
+
+    auto graph = callgraph::build(*code);
+    auto recursive = callgraph::recursive(graph);
+    auto tuple_returns = tuple_return::analyze(mod, *code);
+
+    ModuleStats result{
+        .bytecode_size = mod.bytecode.size(),
+        .strtab_size = mod.strtab.size(),
+        .globals = mod.global_count,
+        .symbols = static_cast<uint32_t>(mod.symtab.size()),
+    };
+
+    for (const auto &proc : code->procs) {
+        ProcStats stats{
+            .addr = proc.addr,
+            .name = mod.symbol_at(proc.addr),
+            .size = proc.end - proc.addr,
+            .instrs = static_cast<uint32_t>(proc.last - proc.first),
+            .callees = static_cast<uint32_t>(graph.callees[proc.addr].size()),
+            .recursive = recursive.contains(proc.addr),
+        };
+
+        if (auto it = info.procs.find(proc.addr); it != info.procs.end()) {
+            stats.info = it->second;
+        }
+
+        auto tuple_it =
+            std::ranges::lower_bound(tuple_returns, proc.addr, {}, &tuple_return::Proc::addr);
+
+        if (tuple_it != tuple_returns.end() && tuple_it->addr == proc.addr) {
+            stats.tuple_return = *tuple_it;
+            ++result.tuple_returns;
+            result.replaceable_tuple_returns += tuple_it->replaceable();
+        }
+
+        for (size_t i = proc.first; i < proc.last; ++i) {
+            auto opcode = code->instrs[i].opcode;
+            auto name = disas::opcode_name(opcode);
+            ++stats.instr_mix[name];
+            ++result.instr_mix[name];
+
+            if (allocates(opcode)) {
+                ++stats.alloc_sites;
+            }
+
+            if (opcode == Instr::CallC) {
+                ++stats.indirect_calls;
+            }
+        }
+
+        result.instrs += stats.instrs;
+        result.alloc_sites += stats.alloc_sites;
+        result.indirect_calls += stats.indirect_calls;
+        result.recursive_procs += stats.recursive;
+        result.procs.push_back(std::move(stats));
+    }
+
+    return result;
+}
+
+void friar::stats::write_text(const ModuleStats &stats, std::ostream &s) {
+    std::println(
+        s,
+        "{:>10} {:>8} {:>7} {:>6} {:>6} {:>8} {:>6} {:>6} {:>7} {:>5} {:>3}  {}",
+        "addr",
+        "size",
+        "instrs",
+        "params",
+        "locals",
+        "captures",
+        "stack",
+        "allocs",
+        "callees",
+        "callc",
+        "rec",
+        "name"
+    );
+
+    for (const auto &proc : stats.procs) {
+        std::print(
+            s,
+            "{:#10x} {:>8} {:>7} {:>6} {:>6} {:>8} {:>6} {:>6} {:>7} {:>5} {:>3}  ",
+            proc.addr,
+            proc.size,
+            proc.instrs,
+            proc.info.params,
+            proc.info.locals,
+            proc.info.captures,
+            proc.info.stack_size,
+            proc.alloc_sites,
+            proc.callees,
+            proc.indirect_calls,
+            proc.recursive ? "yes" : "no"
+        );
+
+        if (proc.name) {
+            std::println(s, "{}", *proc.name);
+        } else {
+            std::println(s, "<anon {:#x}>", proc.addr);
+        }
+    }
+
+    std::println(s, "");
+    std::println(
+        s, "Procedures:      {} ({} recursive)", stats.procs.size(), stats.recursive_procs
+    );
+    std::println(s, "Instructions:    {}", stats.instrs);
+    std::println(s, "Bytecode size:   {} bytes", stats.bytecode_size);
+    std::println(s, "String table:    {} bytes", stats.strtab_size);
+    std::println(s, "Globals:         {}", stats.globals);
+    std::println(s, "Public symbols:  {}", stats.symbols);
+    std::println(s, "Alloc sites:     {}", stats.alloc_sites);
+    std::println(s, "Closure calls:   {}", stats.indirect_calls);
+    std::println(
+        s,
+        "Tuple returns:   {} ({} replaceable)",
+        stats.tuple_returns,
+        stats.replaceable_tuple_returns
+    );
+
+    if (stats.tuple_returns > 0) {
+        std::println(s, "");
+        std::println(s, "Tuple-returning procedures:");
+
+        for (const auto &proc : stats.procs) {
+            if (!proc.tuple_return) {
+                continue;
+            }
+
+            const auto &tuple = *proc.tuple_return;
+
+            if (proc.name) {
+                std::print(s, "  {:<24}", *proc.name);
+            } else {
+                std::print(s, "  {:<24}", std::format("<anon {:#x}>", proc.addr));
+            }
+
+            std::println(
+                s,
+                " {} of {}, {}/{} call sites destructure{}{}",
+                tuple.sexp ? "sexp" : "array",
+                tuple.elems,
+                tuple.destructured_sites,
+                tuple.call_sites,
+                tuple.escapes ? ", escapes as a closure" : "",
+                tuple.replaceable() ? ", replaceable" : ""
+            );
+        }
+    }
+
+    std::println(s, "");
+    std::println(s, "Instruction mix:");
+
+    for (const auto &[name, count] : by_frequency(stats.instr_mix)) {
+        std::println(
+            s,
+            "  {:<16} {:>8}  {:>5.1f}%",
+            name,
+            count,
+            stats.instrs == 0 ? 0.0 : 100.0 * count / stats.instrs
+        );
+    }
+}
+
+void friar::stats::write_json(const ModuleStats &stats, std::ostream &s) {
+    std::print(
+        s,
+        "{{\"bytecode_size\": {}, \"strtab_size\": {}, \"globals\": {}, \"symbols\": {}, "
+        "\"instrs\": {}, \"alloc_sites\": {}, \"indirect_calls\": {}, \"recursive_procs\": {}, "
+        "\"tuple_returns\": {}, \"replaceable_tuple_returns\": {}, \"instr_mix\": ",
+        stats.bytecode_size,
+        stats.strtab_size,
+        stats.globals,
+        stats.symbols,
+        stats.instrs,
+        stats.alloc_sites,
+        stats.indirect_calls,
+        stats.recursive_procs,
+        stats.tuple_returns,
+        stats.replaceable_tuple_returns
+    );
+    write_json_mix(stats.instr_mix, s);
+    s << ", \"procs\": [";
+
+    for (bool first = true; const auto &proc : stats.procs) {
+        s << (first ? "\n  " : ",\n  ");
+        first = false;
+
+        std::print(s, "{{\"addr\": {}, \"name\": ", proc.addr);
+
+        if (proc.name) {
+            util::write_json_string(s, *proc.name);
+        } else {
+            s << "null";
+        }
+
+        std::print(
+            s,
+            ", \"size\": {}, \"instrs\": {}, \"params\": {}, \"locals\": {}, \"captures\": {}, "
+            "\"stack_size\": {}, \"closure\": {}, \"alloc_sites\": {}, \"callees\": {}, "
+            "\"indirect_calls\": {}, \"recursive\": {}, \"tuple_return\": ",
+            proc.size,
+            proc.instrs,
+            proc.info.params,
+            proc.info.locals,
+            proc.info.captures,
+            proc.info.stack_size,
+            proc.info.is_closure,
+            proc.alloc_sites,
+            proc.callees,
+            proc.indirect_calls,
+            proc.recursive
+        );
+
+        if (const auto &tuple = proc.tuple_return) {
+            std::print(
+                s,
+                "{{\"elems\": {}, \"sexp\": {}, \"call_sites\": {}, \"destructured_sites\": {}, "
+                "\"escapes\": {}, \"replaceable\": {}}}",
+                tuple->elems,
+                tuple->sexp,
+                tuple->call_sites,
+                tuple->destructured_sites,
+                tuple->escapes,
+                tuple->replaceable()
+            );
+        } else {
+            s << "null";
+        }
+
+        s << ", \"instr_mix\": ";
+        write_json_mix(proc.instr_mix, s);
+        s << "}";
+    }
+
+    std::println(s, "\n]}}");
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "tuple_return.hpp"
+#include "verifier.hpp"
+
+namespace friar::stats {
+
+/// The number of occurrences of each instruction, keyed by its mnemonic.
+using InstrMix = std::map<std::string_view, uint32_t>;
+
+/// The static statistics of a procedure.
+struct ProcStats {
+    uint32_t addr = 0;
+
+    /// The name of the public symbol defined at `addr`, if there is one.
+    std::optional<std::string_view> name;
+
+    /// The size of the procedure's bytecode in bytes.
+    uint32_t size = 0;
+
+    uint32_t instrs = 0;
+
+    /// The parameter, local, capture counts and the maximum stack size computed by the verifier.
+    verifier::ModuleInfo::Proc info;
+
+    InstrMix instr_mix;
+
+    /// The number of instructions that allocate a heap object.
+    uint32_t alloc_sites = 0;
+
+    /// The number of distinct procedures called directly or instantiated as closures.
+    uint32_t callees = 0;
+
+    /// The number of closure calls (`CALLC`), whose targets are not known statically.
+    uint32_t indirect_calls = 0;
+
+    /// Whether the procedure may call itself, directly or through other procedures.
+    bool recursive = false;
+
+    /// Set if the procedure returns a freshly allocated tuple on every path.
+    std::optional<tuple_return::Proc> tuple_return;
+};
+
+/// The static statistics of a module.
+struct ModuleStats {
+    std::vector<ProcStats> procs;
+
+    size_t bytecode_size = 0;
+    size_t strtab_size = 0;
+    uint32_t globals = 0;
+    uint32_t symbols = 0;
+
+    uint32_t instrs = 0;
+    uint32_t alloc_sites = 0;
+    uint32_t indirect_calls = 0;
+    uint32_t recursive_procs = 0;
+    uint32_t tuple_returns = 0;
+
+    /// The number of tuple-returning procedures whose result can be passed as separate values.
+    uint32_t replaceable_tuple_returns = 0;
+
+    InstrMix instr_mix;
+};
+
+/// Computes the statistics of a verified module.
+std::expected<ModuleStats, std::string>
+collect(const bytecode::Module &mod, const verifier::ModuleInfo &info);
+
+/// Writes a human-readable report: a table of procedures followed by the module totals.
+void write_text(const ModuleStats &stats, std::ostream &s);
+
+/// Writes the statistics as a JSON object.
+void write_json(const ModuleStats &stats, std::ostream &s);
+
+} // namespace friar::stats
@@ -0,0 +1,105 @@
+#include "strip.hpp"
+
+#include <array>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "callgraph.hpp"
+#include "rewrite.hpp"
+
+using namespace friar;
+using namespace friar::strip;
+using friar::bytecode::Instr;
+
+std::expected<Result, std::string> friar::strip::strip(const bytecode::Module &mod, Opts opts) {
+    auto code = rewrite::decode_code(mod);
+
+    if (!code) {
+        return std::unexpected(std::move(code).error());
+    }
+
+    if (code->procs.empty() || code->procs.front().addr != 0) {
+        return std::unexpected("the module has no main procedure");
+    }
+
+    Summary summary{
+        .procs = static_cast<uint32_t>(code->procs.size()),
+        .bytecode_size = mod.bytecode.size(),
+        .strtab_size = mod.strtab.size(),
+    };
+
+    constexpr std::array<uint32_t, 1> roots = {0};
+    auto live = callgraph::reachable(callgraph::build(*code), roots);
+    std::vector<rewrite::Fragment> fragments;
+
+    for (const auto &proc : code->procs) {
+        if (!live.contains(proc.addr)) {
+            ++summary.removed_procs;
+
+            continue;
+        }
+
+        if (!opts.strip_lines) {
+            fragments.push_back(
+                rewrite::Fragment{
+                    .start = proc.addr,
+                    .end = proc.end,
+                }
+            );
+
+            continue;
+        }
+
+        // split the procedure around its `LINE` instructions; jumps to them land on the next
+        // instruction instead.
+        std::optional<uint32_t> dropped_from;
+
+        for (size_t i = proc.first; i < proc.last; ++i) {
+            const auto &instr = code->instrs[i];
+
+            if (instr.opcode == Instr::Line) {
+                ++summary.removed_lines;
+
+                if (!dropped_from) {
+                    dropped_from = instr.addr;
+                }
+
+                continue;
+            }
+
+            if (dropped_from || fragments.empty() || fragments.back().end != instr.addr) {
+                fragments.push_back(
+                    rewrite::Fragment{
+                        .start = instr.addr,
+                        .end = instr.end,
+                        .aliased_from = std::exchange(dropped_from, std::nullopt),
+                    }
+                );
+            } else {
+                fragments.back().end = instr.end;
+            }
+        }
+    }
+
+    auto stripped = rewrite::assemble(mod, *code, fragments);
+
+    if (!stripped) {
+        return std::unexpected(std::move(stripped).error());
+    }
+
+    auto stripped_code = rewrite::decode_code(*stripped);
+
+    if (!stripped_code) {
+        return std::unexpected(std::move(stripped_code).error());
+    }
+
+    rewrite::compact_strtab(*stripped, *stripped_code);
+    summary.new_bytecode_size = stripped->bytecode.size();
+    summary.new_strtab_size = stripped->strtab.size();
+
+    return Result{
+        .mod = std::move(*stripped),
+        .summary = summary,
+    };
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <string>
+
+#include "bytecode.hpp"
+
+namespace friar::strip {
+
+struct Opts {
+    /// Whether to remove `LINE` instructions as well.
+    bool strip_lines = false;
+};
+
+/// What stripping has removed.
+struct Summary {
+    uint32_t procs = 0;
+    uint32_t removed_procs = 0;
+    uint32_t removed_lines = 0;
+    size_t bytecode_size = 0;
+    size_t new_bytecode_size = 0;
+    size_t strtab_size = 0;
+    size_t new_strtab_size = 0;
+};
+
+struct Result {
+    bytecode::Module mod;
+    Summary summary;
+};
+
+/// Removes the procedures of a verified module that cannot be reached from the main procedure,
+/// along with the string table entries nothing refers to any more.
+///
+/// Symbols of removed procedures are dropped. Without `LINE` instructions, runtime errors are
+/// reported without source lines.
+std::expected<Result, std::string> strip(const bytecode::Module &mod, Opts opts);
+
+} // namespace friar::strip
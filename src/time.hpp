@@ -4,11 +4,17 @@
 #include <string>
 #include <vector>
 
+#include "util.hpp"
+
 namespace friar::time {
 
 struct Measurement {
     std::string name;
+    std::chrono::steady_clock::time_point start;
     std::chrono::nanoseconds elapsed;
+
+    /// How much the peak resident set size of the process grew during the stage, in bytes.
+    uint64_t peak_rss_growth = 0;
 };
 
 struct Timings {
@@ -24,12 +30,15 @@ struct Timings {
         Measurement measurement;
         measurement.name = name;
 
+        auto start_rss = util::peak_rss();
         auto start = std::chrono::steady_clock::now();
 
         decltype(f()) result = f();
         auto end = std::chrono::steady_clock::now();
 
+        measurement.start = start;
         measurement.elapsed = end - start;
+        measurement.peak_rss_growth = util::peak_rss() - start_rss;
         measurements.push_back(measurement);
 
         return result;
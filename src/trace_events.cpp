@@ -0,0 +1,59 @@
+#include "trace_events.hpp"
+
+#include <algorithm>
+#include <print>
+#include <utility>
+
+#include "util.hpp"
+
+using namespace friar;
+using namespace friar::trace_events;
+
+void Recorder::add_span(
+    std::string name,
+    std::string_view category,
+    Clock::time_point start,
+    Clock::time_point end
+) {
+    events_.push_back(
+        Event{
+            .name = std::move(name),
+            .category = category,
+            .start = start,
+            .duration = end - start,
+        }
+    );
+}
+
+void Recorder::write(std::ostream &s) const {
+    using Micros = std::chrono::duration<double, std::micro>;
+
+    // timestamps are relative to the earliest event.
+    auto origin = Clock::time_point::max();
+
+    for (const auto &event : events_) {
+        origin = std::min(origin, event.start);
+    }
+
+    s << "{\"traceEvents\":[";
+
+    for (bool first = true; const auto &event : events_) {
+        if (!first) {
+            s << ",";
+        }
+
+        first = false;
+        s << "\n{\"name\":";
+        util::write_json_string(s, event.name);
+        s << ",\"cat\":";
+        util::write_json_string(s, event.category);
+        std::print(
+            s,
+            ",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":{:.3f},\"dur\":{:.3f}}}",
+            Micros(event.start - origin).count(),
+            Micros(event.duration).count()
+        );
+    }
+
+    s << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
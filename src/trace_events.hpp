@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace friar::trace_events {
+
+using Clock = std::chrono::steady_clock;
+
+/// Collects timeline events and writes them in the Chrome Trace Event format.
+class Recorder {
+public:
+    /// The minimum duration of a procedure call for it to be recorded.
+    ///
+    /// If unset, procedure calls are not recorded at all.
+    std::optional<std::chrono::nanoseconds> call_threshold;
+
+    /// The minimum duration of an I/O operation for it to be recorded.
+    ///
+    /// Operations that complete faster than this are assumed not to have blocked.
+    std::chrono::nanoseconds io_threshold = std::chrono::microseconds(10);
+
+    /// Records an event spanning the time from `start` to `end`.
+    void add_span(
+        std::string name,
+        std::string_view category,
+        Clock::time_point start,
+        Clock::time_point end
+    );
+
+    /// Writes the recorded events as a JSON object.
+    void write(std::ostream &s) const;
+
+private:
+    struct Event {
+        std::string name;
+        std::string_view category;
+        Clock::time_point start;
+        Clock::duration duration;
+    };
+
+    std::vector<Event> events_;
+};
+
+} // namespace friar::trace_events
@@ -0,0 +1,387 @@
+#include "tuple_return.hpp"
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <utility>
+
+#include "util.hpp"
+
+using namespace friar;
+using namespace friar::tuple_return;
+using friar::bytecode::Instr;
+using friar::rewrite::Instruction;
+
+namespace {
+
+// the kind of tuple a procedure returns.
+struct Shape {
+    uint32_t elems = 0;
+    bool sexp = false;
+
+    // the string table offset of the tag (for S-expressions).
+    uint32_t tag = 0;
+
+    bool operator==(const Shape &) const = default;
+};
+
+class Analyzer {
+public:
+    Analyzer(const bytecode::Module &mod, const rewrite::Code &code)
+        : mod_(mod)
+        , code_(code) {
+        for (size_t i = 0; i < code.instrs.size(); ++i) {
+            const auto &instr = code.instrs[i];
+
+            switch (instr.opcode) {
+            case Instr::Jmp:
+            case Instr::CjmpZ:
+            case Instr::CjmpNz:
+                jumps_to_[instr.target].push_back(i);
+                break;
+
+            default:
+                break;
+            }
+        }
+    }
+
+    std::vector<Proc> run() {
+        std::map<uint32_t, std::pair<Proc, Shape>> procs;
+
+        for (const auto &proc : code_.procs) {
+            std::vector<uint32_t> allocs;
+
+            if (auto shape = returned_shape(proc, allocs)) {
+                rewrites_[proc.addr] = std::move(allocs);
+                procs.emplace(
+                    proc.addr,
+                    std::pair{
+                        Proc{
+                            .addr = proc.addr,
+                            .elems = shape->elems,
+                            .sexp = shape->sexp,
+                        },
+                        *shape,
+                    }
+                );
+            }
+        }
+
+        for (const auto &proc : code_.procs) {
+            for (size_t i = proc.first; i < proc.last; ++i) {
+                const auto &instr = code_.instrs[i];
+
+                if (instr.opcode != Instr::Call && instr.opcode != Instr::Closure) {
+                    continue;
+                }
+
+                auto it = procs.find(instr.target);
+
+                if (it == procs.end()) {
+                    continue;
+                }
+
+                auto &[callee, shape] = it->second;
+
+                if (instr.opcode == Instr::Closure) {
+                    callee.escapes = true;
+                } else {
+                    ++callee.call_sites;
+                    callee.destructured_sites +=
+                        destructures(proc, i + 1, shape, rewrites_[callee.addr]);
+                }
+            }
+        }
+
+        std::vector<Proc> result;
+        result.reserve(procs.size());
+
+        for (const auto &[addr, entry] : procs) {
+            result.push_back(entry.first);
+        }
+
+        return result;
+    }
+
+    // the addresses of the instructions that `scalar_replace` swaps for a procedure found by `run`:
+    // the allocations of the returned tuple and the instructions destructuring it at the call
+    // sites.
+    const std::vector<uint32_t> &rewrites(uint32_t addr) const {
+        return rewrites_.at(addr);
+    }
+
+private:
+    bool is_jump_target(const Instruction &instr) const {
+        return jumps_to_.contains(instr.addr);
+    }
+
+    uint32_t imm(const Instruction &instr, size_t idx) const {
+        auto bc = std::span(mod_.bytecode);
+
+        return util::from_u32_le(
+            std::span<const std::byte, 4>(std::as_bytes(bc.subspan(instr.addr + 1 + 4 * idx, 4)))
+        );
+    }
+
+    // returns the shape of the tuple allocated by the instruction, if it allocates one.
+    std::optional<Shape> shape_of(const Instruction &instr) const {
+        switch (instr.opcode) {
+        case Instr::CallBarray:
+            return Shape{.elems = imm(instr, 0)};
+
+        case Instr::Sexp:
+            return Shape{.elems = imm(instr, 1), .sexp = true, .tag = instr.string};
+
+        default:
+            return std::nullopt;
+        }
+    }
+
+    // returns the instruction that allocated the tuple on top of the stack when control reaches
+    // `code_.instrs[idx]` by falling through, if it is known to have been allocated right before.
+    const Instruction *alloc_before(const rewrite::Proc &proc, size_t idx) const {
+        while (idx > proc.first) {
+            const auto &instr = code_.instrs[--idx];
+
+            if (instr.opcode != Instr::Line) {
+                return shape_of(instr) ? &instr : nullptr;
+            }
+
+            // a line marker that is jumped to has other predecessors.
+            if (is_jump_target(instr)) {
+                return nullptr;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // returns the shape of the tuple returned by the procedure on every path, if there is one, and
+    // adds the addresses of the instructions allocating it to `allocs`.
+    std::optional<Shape>
+    returned_shape(const rewrite::Proc &proc, std::vector<uint32_t> &allocs) const {
+        std::optional<Shape> result;
+
+        auto merge = [&](const Instruction *alloc) {
+            if (!alloc) {
+                return false;
+            }
+
+            auto shape = shape_of(*alloc);
+
+            if (shape->elems == 0 || (result && *result != *shape)) {
+                return false;
+            }
+
+            result = shape;
+
+            // several returns may share an allocation.
+            if (std::ranges::find(allocs, alloc->addr) == allocs.end()) {
+                allocs.push_back(alloc->addr);
+            }
+
+            return true;
+        };
+
+        for (size_t i = proc.first; i < proc.last; ++i) {
+            const auto &instr = code_.instrs[i];
+
+            if (instr.opcode != Instr::End && instr.opcode != Instr::Ret) {
+                continue;
+            }
+
+            if (i > proc.first && code_.instrs[i - 1].falls_through()
+                && !merge(alloc_before(proc, i))) {
+                return std::nullopt;
+            }
+
+            auto it = jumps_to_.find(instr.addr);
+
+            if (it == jumps_to_.end()) {
+                continue;
+            }
+
+            for (auto jump : it->second) {
+                const auto &jmp = code_.instrs[jump];
+
+                // a conditional jump leaves an unknown value on the stack; a jump that is itself a
+                // jump target may be reached from elsewhere.
+                if (jmp.opcode != Instr::Jmp || is_jump_target(jmp)
+                    || !merge(alloc_before(proc, jump))) {
+                    return std::nullopt;
+                }
+            }
+        }
+
+        return result;
+    }
+
+    // checks whether the result of a call is only destructured by the instructions starting at
+    // `code_.instrs[idx]`. if so, adds the addresses of the instructions reading the tuple to
+    // `rewrites`.
+    //
+    // the interpreter keeps the values passed by a scalar-replaced procedure where the collector
+    // does not see them, so none of the accepted instructions may allocate.
+    bool destructures(
+        const rewrite::Proc &proc,
+        size_t idx,
+        const Shape &shape,
+        std::vector<uint32_t> &rewrites
+    ) const {
+        std::vector<uint32_t> reads;
+
+        auto next = [&]() -> const Instruction * {
+            while (idx < proc.last) {
+                const auto &instr = code_.instrs[idx++];
+
+                if (is_jump_target(instr)) {
+                    return nullptr;
+                }
+
+                if (instr.opcode != Instr::Line) {
+                    return &instr;
+                }
+            }
+
+            return nullptr;
+        };
+
+        auto is = [](const Instruction *instr, Instr opcode) {
+            return instr && instr->opcode == opcode;
+        };
+
+        // `CONST k; ELEM` with `k` in bounds.
+        auto loads_element = [&](const Instruction *instr) {
+            if (!is(instr, Instr::Const) || imm(*instr, 0) >= shape.elems) {
+                return false;
+            }
+
+            instr = next();
+
+            if (!is(instr, Instr::Elem)) {
+                return false;
+            }
+
+            reads.push_back(instr->addr);
+
+            return true;
+        };
+
+        auto done = [&] {
+            rewrites.insert(rewrites.end(), reads.begin(), reads.end());
+
+            return true;
+        };
+
+        auto stores = [&](const Instruction *instr) {
+            return is(instr, Instr::StG) || is(instr, Instr::StL) || is(instr, Instr::StA)
+                || is(instr, Instr::StC);
+        };
+
+        bool loaded = false;
+
+        while (true) {
+            auto *instr = next();
+
+            // the tuple is discarded.
+            if (is(instr, Instr::Drop)) {
+                return loaded && done();
+            }
+
+            // the last element is loaded, consuming the tuple.
+            if (loads_element(instr)) {
+                return done();
+            }
+
+            if (!is(instr, Instr::Dup)) {
+                return false;
+            }
+
+            instr = next();
+
+            // a pattern check that always succeeds, since the shape is known.
+            if (is(instr, shape.sexp ? Instr::Tag : Instr::Array)) {
+                if (imm(*instr, shape.sexp ? 1 : 0) != shape.elems
+                    || (shape.sexp && instr->string != shape.tag)) {
+                    return false;
+                }
+
+                reads.push_back(instr->addr);
+
+                // execution continues with the next instruction when the check succeeds.
+                if (!is(next(), Instr::CjmpZ)) {
+                    return false;
+                }
+
+                continue;
+            }
+
+            if (!loads_element(instr) || !stores(next()) || !is(next(), Instr::Drop)) {
+                return false;
+            }
+
+            loaded = true;
+        }
+    }
+
+    const bytecode::Module &mod_;
+    const rewrite::Code &code_;
+
+    // the indices of the jump instructions targeting each address.
+    std::unordered_map<uint32_t, std::vector<size_t>> jumps_to_;
+
+    // see `rewrites`.
+    std::unordered_map<uint32_t, std::vector<uint32_t>> rewrites_;
+};
+
+// returns the instruction that replaces `opcode` in scalar-replaced code.
+Instr values_opcode(Instr opcode) {
+    switch (opcode) {
+    case Instr::CallBarray:
+        return Instr::Values;
+
+    case Instr::Sexp:
+        return Instr::SexpValues;
+
+    case Instr::Elem:
+        return Instr::ElemValue;
+
+    case Instr::Array:
+        return Instr::ArrayValues;
+
+    case Instr::Tag:
+        return Instr::TagValues;
+
+    default:
+        std::unreachable();
+    }
+}
+
+} // namespace
+
+std::vector<Proc>
+friar::tuple_return::analyze(const bytecode::Module &mod, const rewrite::Code &code) {
+    return Analyzer(mod, code).run();
+}
+
+uint32_t friar::tuple_return::scalar_replace(bytecode::Module &mod, const rewrite::Code &code) {
+    Analyzer analyzer(mod, code);
+    uint32_t result = 0;
+
+    for (const auto &proc : analyzer.run()) {
+        if (!proc.replaceable()) {
+            continue;
+        }
+
+        for (auto addr : analyzer.rewrites(proc.addr)) {
+            mod.bytecode[addr] = values_opcode(mod.bytecode[addr]);
+        }
+
+        ++result;
+    }
+
+    return result;
+}
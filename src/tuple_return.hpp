@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "rewrite.hpp"
+
+namespace friar::tuple_return {
+
+/// The maximum number of elements of a tuple passed as separate values by `scalar_replace`.
+constexpr uint32_t max_values = 16;
+
+/// A procedure that returns a freshly allocated tuple (an array or an S-expression) on every path.
+struct Proc {
+    uint32_t addr = 0;
+
+    /// The number of elements of the returned tuple.
+    uint32_t elems = 0;
+
+    /// Whether the tuple is an S-expression rather than an array.
+    bool sexp = false;
+
+    /// The number of `CALL` instructions targeting the procedure.
+    uint32_t call_sites = 0;
+
+    /// The number of call sites that only read elements of the result and then discard it.
+    uint32_t destructured_sites = 0;
+
+    /// Whether the procedure is also instantiated as a closure and may thus be called from unknown
+    /// sites.
+    bool escapes = false;
+
+    /// Whether `scalar_replace` passes the tuple as multiple return values instead: all callers are
+    /// known, each of them destructures the result right away, the tuple has at most `max_values`
+    /// elements, and the procedure is not the main one (which the interpreter calls itself).
+    bool replaceable() const noexcept {
+        return !escapes && call_sites > 0 && destructured_sites == call_sites
+            && elems <= max_values && addr != 0;
+    }
+};
+
+/// Finds the procedures that return tuples and classifies their call sites.
+///
+/// The analysis is conservative: a procedure qualifies only if each of its `END` and `RET`
+/// instructions is reached solely from a `CALL Barray n` or `SEXP s n` (possibly through a `JMP`).
+/// A call site is destructuring if the result is only checked by `ARRAY n` or `TAG s n`, has its
+/// elements loaded with `CONST k; ELEM` and stored, and is then dropped.
+///
+/// `code` must be the decoded bytecode of `mod`. The result is ordered by address.
+std::vector<Proc> analyze(const bytecode::Module &mod, const rewrite::Code &code);
+
+/// Makes the procedures found by `analyze` that are `replaceable` pass the elements of their tuple
+/// to the callers directly instead of allocating it.
+///
+/// The instructions allocating the tuple are replaced by `VALUES`, and the instructions checking
+/// and destructuring it at the call sites read the passed values instead. These opcodes are
+/// internal to the interpreter and never appear in bytecode files. The immediates are left intact,
+/// so `writer::clear_annotations` can restore the original instructions.
+///
+/// Must be applied after verification, since the verifier rejects these opcodes. `code` must be
+/// the decoded bytecode of `mod`. Returns the number of rewritten procedures.
+uint32_t scalar_replace(bytecode::Module &mod, const rewrite::Code &code);
+
+} // namespace friar::tuple_return
@@ -1,6 +1,10 @@
 #include "util.hpp"
 
 #include <cerrno>
+#include <print>
+
+#include <sys/resource.h>
+#include <unistd.h>
 
 using namespace friar;
 using namespace friar::util;
@@ -9,6 +13,36 @@ std::error_code friar::util::get_last_error() noexcept {
     return std::make_error_code(std::errc(errno));
 }
 
+bool friar::util::write_all(int fd, const char *data, size_t len) noexcept {
+    while (len > 0) {
+        auto r = write(fd, data, len);
+
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        data += r;
+        len -= static_cast<size_t>(r);
+    }
+
+    return true;
+}
+
+uint64_t friar::util::peak_rss() noexcept {
+    rusage usage{};
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+    // Linux reports the size in kibibytes.
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+}
+
 std::expected<std::ifstream, std::error_code> friar::util::open_file(std::filesystem::path &path) {
     errno = 0;
     std::ifstream s(path);
@@ -19,3 +53,28 @@ std::expected<std::ifstream, std::error_code> friar::util::open_file(std::filesy
 
     return s;
 }
+
+void friar::util::write_json_string(std::ostream &s, std::string_view str) {
+    s << '"';
+
+    for (auto c : str) {
+        switch (c) {
+        case '"':
+            s << "\\\"";
+            break;
+
+        case '\\':
+            s << "\\\\";
+            break;
+
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                std::print(s, "\\u{:04x}", static_cast<unsigned>(c));
+            } else {
+                s << c;
+            }
+        }
+    }
+
+    s << '"';
+}
@@ -5,7 +5,9 @@
 #include <expected>
 #include <filesystem>
 #include <fstream>
+#include <ostream>
 #include <span>
+#include <string_view>
 #include <system_error>
 
 namespace friar::util {
@@ -19,6 +21,15 @@ std::expected<std::ifstream, std::error_code> open_file(std::filesystem::path &p
 
 std::error_code get_last_error() noexcept;
 
+/// Writes `len` bytes to `fd`, retrying short and interrupted writes. Returns `false` on failure.
+bool write_all(int fd, const char *data, size_t len) noexcept;
+
+/// Returns the peak resident set size of the process in bytes.
+uint64_t peak_rss() noexcept;
+
+/// Writes `str` as a JSON string literal.
+void write_json_string(std::ostream &s, std::string_view str);
+
 constexpr size_t compute_decimal_width(size_t v) {
     // ported from Rust's ilog10 implementation.
     constexpr size_t c1 = 0b011'00000000000000000 - 10;
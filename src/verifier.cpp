@@ -20,6 +20,7 @@ using namespace friar;
 using namespace friar::verifier;
 using bytecode::Instr;
 using util::overloaded;
+using CapturedVar = ModuleInfo::CapturedVar;
 
 namespace {
 
@@ -36,7 +37,37 @@ public:
             return std::unexpected(std::move(r).error());
         }
 
-        ModuleInfo result;
+        ModuleInfo result{
+            .scratch_bytes = scratch_bytes(),
+        };
+
+        // a closure can refer to the captures of the enclosing closure instead of copying them if
+        // they are all it captures and neither procedure stores to captured variables. the choice
+        // affects how the procedure reads its captures, so it must hold for every instantiation.
+        std::unordered_map<uint32_t, bool> shares_captures;
+        std::vector<const Closure *> sites;
+
+        for (const auto &req : post_validate_reqs_) {
+            const auto *closure = std::get_if<Closure>(&req);
+
+            if (!closure) {
+                continue;
+            }
+
+            // the site index and the capture count must fit into the capture count immediate.
+            bool has_site = closure->captures > 0 && closure->captures <= 0xffff
+                && sites.size() < max_closure_sites;
+
+            if (has_site) {
+                sites.push_back(closure);
+            }
+
+            auto [it, _] = shares_captures.try_emplace(
+                closure->target_addr, !procs_.at(closure->target_addr).stores_captures
+            );
+            it->second = it->second && has_site && closure->copies_captures
+                && !procs_.at(closure->proc_addr).stores_captures;
+        }
 
         for (auto &[addr, info] : procs_) {
             std::span<std::byte, 4> hi_imm_bytes(std::as_writable_bytes(bc_.subspan(addr + 1, 4)));
@@ -44,6 +75,14 @@ public:
             hi_imm |= uint32_t(info.stack_size) << 16;
             util::to_u32_le(hi_imm_bytes, hi_imm);
 
+            if (auto it = shares_captures.find(addr);
+                info.is_closure && it != shares_captures.end() && it->second) {
+                std::span<std::byte, 4> locals_bytes(
+                    std::as_writable_bytes(bc_.subspan(addr + 5, 4))
+                );
+                util::to_u32_le(locals_bytes, info.locals | shares_captures_flag);
+            }
+
             result.procs[addr] = ModuleInfo::Proc{
                 .params = info.params,
                 .locals = info.locals,
@@ -53,10 +92,50 @@ public:
             };
         }
 
+        result.closure_sites.reserve(sites.size());
+
+        for (const auto *closure : sites) {
+            auto kind = ModuleInfo::ClosureSite::Table;
+
+            if (closure->copies_captures) {
+                kind = shares_captures.at(closure->target_addr) ? ModuleInfo::ClosureSite::Share
+                                                                : ModuleInfo::ClosureSite::Copy;
+            }
+
+            std::span<std::byte, 4> n_bytes(
+                std::as_writable_bytes(bc_.subspan(closure->addr + 5, 4))
+            );
+            util::to_u32_le(
+                n_bytes,
+                closure->captures | uint32_t(result.closure_sites.size()) << 16 | closure_site_flag
+            );
+
+            result.closure_sites.push_back(
+                ModuleInfo::ClosureSite{
+                    .kind = kind,
+                    .first = closure->first_var,
+                }
+            );
+        }
+
+        result.captured_vars = std::move(captured_vars_);
+
         return result;
     }
 
 private:
+    // vectors never release capacity, so their capacity is their peak size.
+    size_t scratch_bytes() const noexcept {
+        // an unordered_map node holds the value and a next pointer (plus the bucket array).
+        auto proc_node_size = sizeof(std::pair<const uint32_t, ProcInfo>) + 2 * sizeof(void *);
+
+        return to_verify_.capacity() * sizeof(VerifyReq)
+            + verified_.capacity() * sizeof(BytecodeInfo) + procs_.size() * proc_node_size
+            + procs_.bucket_count() * sizeof(void *)
+            + post_validate_reqs_.capacity() * sizeof(PostValidateReq)
+            + captured_vars_.capacity() * sizeof(CapturedVar);
+    }
+
     void compute_last_strtab_entry() {
         auto r = std::ranges::find_last(mod_.strtab, '\0');
 
@@ -159,12 +238,22 @@ private:
         uint32_t captures = 0;
         uint16_t stack_size = 0;
         bool is_closure = false;
+
+        // whether the procedure contains an ST C instruction.
+        bool stores_captures = false;
     };
 
     struct Closure {
         uint32_t addr = 0;
+        uint32_t proc_addr = 0;
         uint32_t target_addr = 0;
         uint32_t captures = 0;
+
+        // the index of the first captured variable in `captured_vars_` (if the site has a table).
+        uint32_t first_var = 0;
+
+        // whether the captured variables are exactly C(0), ..., C(captures - 1).
+        bool copies_captures = false;
     };
 
     struct Call {
@@ -368,6 +457,17 @@ private:
                 ));
             }
 
+            if (locals > max_local_count) {
+                return std::unexpected(Error(
+                    op_addr,
+                    std::format(
+                        "a function has too many locals: expected at most {}, got {}",
+                        max_local_count,
+                        locals
+                    )
+                ));
+            }
+
             procs_.insert(
                 {op_addr,
                  ProcInfo{
@@ -753,6 +853,7 @@ private:
         case Instr::StL:
         case Instr::StA:
         case Instr::StC:
+            proc.stores_captures = proc.stores_captures || instr == Instr::StC;
             r = read_varspec(--addr, true).and_then(check_varspec).and_then([&] {
                 return check_stack(1, 1);
             });
@@ -802,9 +903,20 @@ private:
             r = read_u32("call target", addr).and_then([&](auto l) {
                 return read_u32("captured variable count", addr).and_then([&](auto n) {
                     std::expected<void, Error> result;
+                    bool copies_captures = n > 0;
+                    auto first_var = static_cast<uint32_t>(captured_vars_.size());
 
                     for (size_t i = 0; i < n && result; ++i) {
                         result = read_varspec(addr, false).and_then([&](auto varspec) {
+                            copies_captures = copies_captures && varspec.kind == Varspec::Capture
+                                && varspec.idx == i;
+                            captured_vars_.push_back(
+                                CapturedVar{
+                                    .kind = static_cast<CapturedVar::Kind>(varspec.kind),
+                                    .idx = varspec.idx,
+                                }
+                            );
+
                             return check_varspec(varspec);
                         });
                     }
@@ -812,11 +924,20 @@ private:
                     result = result.and_then([&] { return check_stack(0, 1); });
 
                     if (result) {
+                        // only the sites that list their captured variables in a table need
+                        // them decoded.
+                        if (copies_captures || n > 0xffff) {
+                            captured_vars_.resize(first_var);
+                        }
+
                         post_validate_reqs_.emplace_back(
                             Closure{
                                 .addr = op_addr,
+                                .proc_addr = proc_addr,
                                 .target_addr = l,
                                 .captures = n,
+                                .first_var = first_var,
+                                .copies_captures = copies_captures,
                             }
                         );
                     }
@@ -902,6 +1023,9 @@ private:
             break;
 
         case Instr::CallLread:
+        case Instr::CallLreadAll:
+        case Instr::CallLreadLine:
+        case Instr::CallLreadFile:
             r = check_stack(0, 1);
             break;
 
@@ -1072,6 +1196,7 @@ private:
     std::vector<BytecodeInfo> verified_;
     std::unordered_map<uint32_t, ProcInfo> procs_;
     std::vector<PostValidateReq> post_validate_reqs_;
+    std::vector<CapturedVar> captured_vars_;
 };
 
 } // namespace
@@ -3,6 +3,7 @@
 #include <expected>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "bytecode.hpp"
 
@@ -11,9 +12,20 @@ namespace friar::verifier {
 constexpr uint32_t max_stack_size = 0xffff;
 constexpr uint32_t max_captures = 0x7fff'ffff;
 constexpr uint32_t max_param_count = 0xffff;
+constexpr uint32_t max_local_count = 0x7fff'ffff;
 constexpr uint32_t max_member_count = 0xffff;
 constexpr uint32_t max_elem_count = 0xfff'ffff;
 
+/// Set by the verifier in the capture count immediate of a `CLOSURE` instruction that has an entry
+/// in `ModuleInfo::closure_sites`. The index of the entry is stored in bits 16 to 30, and the
+/// capture count in the lower half.
+constexpr uint32_t closure_site_flag = 0x8000'0000;
+constexpr uint32_t max_closure_sites = 0x8000;
+
+/// Set by the verifier in the local count immediate of a `CBEGIN` procedure whose closures are all
+/// instantiated by `ModuleInfo::ClosureSite::Share` sites.
+constexpr uint32_t shares_captures_flag = 0x8000'0000;
+
 /// A verification error.
 struct Error {
     /// The byte offset where the error occurred.
@@ -33,10 +45,52 @@ struct ModuleInfo {
         bool is_closure = false;
     };
 
+    /// A variable captured by a `CLOSURE` instruction.
+    struct CapturedVar {
+        enum Kind : uint8_t {
+            Global,
+            Local,
+            Param,
+            Capture,
+        } kind = Global;
+
+        uint32_t idx = 0;
+    };
+
+    /// How a `CLOSURE` instruction fills in the captures of the new closure.
+    struct ClosureSite {
+        enum Kind : uint8_t {
+            /// The captured variables are listed in `captured_vars`, starting at `first`.
+            Table,
+
+            /// The captured variables are `C(0)`, ..., `C(n - 1)`: the enclosing closure's first
+            /// `n` captures are copied.
+            Copy,
+
+            /// Like `Copy`, but no procedure that can see the captures stores to them. Instead of a
+            /// copy, the new closure only holds the closure that owns the captures: the enclosing
+            /// closure or, if that one shares them as well, its owner.
+            Share,
+        } kind = Table;
+
+        uint32_t first = 0;
+    };
+
     std::unordered_map<uint32_t, Proc> procs;
+
+    /// Indexed by the upper bits of the capture count immediates (see `closure_site_flag`).
+    std::vector<ClosureSite> closure_sites;
+    std::vector<CapturedVar> captured_vars;
+
+    /// An estimate of the peak memory the verifier used for its own bookkeeping, in bytes.
+    size_t scratch_bytes = 0;
 };
 
 /// Statically verifies the module for validity.
+///
+/// The verifier fills in `symtab_map`, stores each procedure's stack size in the upper half of its
+/// BEGIN instruction's first immediate, and sets `closure_site_flag` and `shares_captures_flag`.
+/// `program::Program::prepare` then makes the remaining changes before the module is run.
 std::expected<ModuleInfo, Error> verify(bytecode::Module &mod);
 
 } // namespace friar::verifier
@@ -0,0 +1,130 @@
+#include "writer.hpp"
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <variant>
+#include <vector>
+
+#include "decode.hpp"
+#include "util.hpp"
+#include "verifier.hpp"
+
+using namespace friar;
+using friar::bytecode::Instr;
+
+namespace {
+
+void write_u32(std::ostream &s, uint32_t value) {
+    std::array<std::byte, 4> bytes;
+    util::to_u32_le(bytes, value);
+    s.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+// returns the instruction replaced by an opcode of `tuple_return::scalar_replace`, or the opcode
+// itself.
+Instr unreplaced(Instr opcode) {
+    switch (opcode) {
+    case Instr::Values:
+        return Instr::CallBarray;
+
+    case Instr::SexpValues:
+        return Instr::Sexp;
+
+    case Instr::ElemValue:
+        return Instr::Elem;
+
+    case Instr::ArrayValues:
+        return Instr::Array;
+
+    case Instr::TagValues:
+        return Instr::Tag;
+
+    default:
+        return opcode;
+    }
+}
+
+} // namespace
+
+void friar::writer::write(const bytecode::Module &mod, std::ostream &s) {
+    write_u32(s, static_cast<uint32_t>(mod.strtab.size()));
+    write_u32(s, mod.global_count);
+    write_u32(s, static_cast<uint32_t>(mod.symtab.size()));
+
+    for (const auto &sym : mod.symtab) {
+        write_u32(s, sym.address);
+        write_u32(s, sym.name);
+    }
+
+    s.write(mod.strtab.data(), static_cast<std::streamsize>(mod.strtab.size()));
+
+    std::vector<Instr> bytecode = mod.bytecode;
+    clear_annotations(bytecode);
+
+    s.write(
+        reinterpret_cast<const char *>(bytecode.data()),
+        static_cast<std::streamsize>(bytecode.size())
+    );
+}
+
+void friar::writer::clear_annotations(std::span<Instr> bytecode) {
+    decode::Decoder decoder(bytecode);
+    bool done = false;
+    Instr opcode = Instr::Eof;
+    size_t imm_idx = 0;
+
+    while (!done && decoder.pos() < bytecode.size()) {
+        decoder.next([&](const decode::Decoder::Result &result) {
+            std::visit(
+                util::overloaded{
+                    [&](const decode::InstrStart &start) {
+                        opcode = unreplaced(start.opcode);
+                        bytecode[start.addr] = opcode;
+                        imm_idx = 0;
+                        done = start.opcode == Instr::Eof;
+                    },
+
+                    [&](const decode::Imm32 &imm) {
+                        auto value = imm.imm;
+
+                        switch (opcode) {
+                        case Instr::Begin:
+                        case Instr::Cbegin:
+                            // the stack size and `shares_captures_flag`.
+                            value &= imm_idx == 0 ? verifier::max_param_count
+                                                  : verifier::max_local_count;
+                            break;
+
+                        case Instr::Closure:
+                            // the closure site index.
+                            if (imm_idx == 1 && (value & verifier::closure_site_flag) != 0) {
+                                value &= 0xffff;
+                            }
+
+                            break;
+
+                        default:
+                            break;
+                        }
+
+                        ++imm_idx;
+
+                        if (value != imm.imm) {
+                            std::span<std::byte, 4> bytes(
+                                std::as_writable_bytes(bytecode.subspan(imm.addr, 4))
+                            );
+                            util::to_u32_le(bytes, value);
+                        }
+                    },
+
+                    // the rest is left as is.
+                    [&](const decode::Error &) { done = true; },
+
+                    [](const auto &) {},
+                },
+                result
+            );
+        });
+    }
+}
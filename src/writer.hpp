@@ -0,0 +1,22 @@
+#pragma once
+
+#include <ostream>
+#include <span>
+
+#include "bytecode.hpp"
+
+namespace friar::writer {
+
+/// Writes a module in the Lama bytecode file format, the inverse of `loader::Loader`.
+///
+/// The module may have been verified: its bytecode is written as if by `clear_annotations`, so the
+/// output is accepted by other Lama bytecode tools. Errors are reported through the stream's state.
+void write(const bytecode::Module &mod, std::ostream &s);
+
+/// Restores the immediates the verifier annotates: the stack sizes and
+/// `verifier::shares_captures_flag` in `BEGIN` and `CBEGIN` instructions, and the closure site
+/// indices in `CLOSURE` instructions. Also restores the instructions replaced by
+/// `tuple_return::scalar_replace`. Valid bytecode that has not been verified is left unchanged.
+void clear_annotations(std::span<bytecode::Instr> bytecode);
+
+} // namespace friar::writer